@@ -27,11 +27,15 @@
 
 #include <kicon.h>
 #include <kdebug.h>
+#include <klocale.h>
 #include <kurl.h>
 
 #include <QtCore/QMimeData>
 
 #include <Soprano/Statement>
+#include <Soprano/Model>
+#include <Soprano/Util/AsyncQuery>
+#include <Soprano/Vocabulary/RDF>
 #include <Soprano/Vocabulary/RDFS>
 #include <Soprano/Vocabulary/NAO>
 #include <Soprano/Vocabulary/NRL>
@@ -139,7 +143,10 @@ class Nepomuk2::Utils::ClassModel::Private
 {
 public:
     Private( ClassModel* parent )
-        : q( parent ) {
+        : countMode( ClassModel::NoInstanceCount ),
+          countQuery( 0 ),
+          countFailed( false ),
+          q( parent ) {
     }
 
     bool createSubClassRelation( const Types::Class& theClass, const Types::Class& newParentClass, bool singleParent );
@@ -147,8 +154,23 @@ public:
     ClassModel::ClassNode* createRootNode( const Types::Class& type );
     ClassModel::ClassNode* findNode( const Types::Class& type, bool autoUpdate = false );
 
+    void closeCountQuery();
+    void emitCountsChanged( ClassModel::ClassNode* node );
+
     QList<ClassModel::ClassNode*> baseClassNodes;
 
+    ClassModel::InstanceCountMode countMode;
+    Soprano::Util::AsyncQuery* countQuery;
+
+    /// the counts which are shown
+    QHash<QUrl, int> instanceCounts;
+
+    /// the counts delivered by the currently running count query
+    QHash<QUrl, int> pendingInstanceCounts;
+
+    /// true if the last count query failed, the counts are shown as unavailable then
+    bool countFailed;
+
 private:
     ClassModel* q;
 };
@@ -204,6 +226,31 @@ Nepomuk2::Utils::ClassModel::ClassNode* Nepomuk2::Utils::ClassModel::Private::fi
 }
 
 
+void Nepomuk2::Utils::ClassModel::Private::closeCountQuery()
+{
+    if( countQuery ) {
+        countQuery->close();
+        countQuery->disconnect( q );
+        countQuery = 0;
+    }
+    pendingInstanceCounts.clear();
+}
+
+
+void Nepomuk2::Utils::ClassModel::Private::emitCountsChanged( ClassModel::ClassNode* node )
+{
+    // we only bother with the nodes which have been created. All others will
+    // pick up the counts once they are fetched.
+    if( !node->children.isEmpty() ) {
+        emit q->dataChanged( q->createIndex( 0, InstanceCountColumn, node->children.first() ),
+                             q->createIndex( node->children.count()-1, InstanceCountColumn, node->children.last() ) );
+        Q_FOREACH( ClassModel::ClassNode* child, node->children ) {
+            emitCountsChanged( child );
+        }
+    }
+}
+
+
 Nepomuk2::Utils::ClassModel::ClassModel( QObject* parent )
     : QAbstractItemModel( parent ),
       d( new Private( this ) )
@@ -213,6 +260,7 @@ Nepomuk2::Utils::ClassModel::ClassModel( QObject* parent )
 
 Nepomuk2::Utils::ClassModel::~ClassModel()
 {
+    d->closeCountQuery();
     delete d;
 }
 
@@ -259,7 +307,7 @@ QList<Nepomuk2::Types::Class> Nepomuk2::Utils::ClassModel::rootClasses() const
 
 int Nepomuk2::Utils::ClassModel::columnCount( const QModelIndex& ) const
 {
-    return 1;
+    return d->countMode == NoInstanceCount ? 1 : 2;
 }
 
 
@@ -269,14 +317,38 @@ QVariant Nepomuk2::Utils::ClassModel::data( const QModelIndex& index, int role )
         ClassNode* node = ( ClassNode* )index.internalPointer();
         Q_ASSERT( node );
 
+        if ( index.column() == InstanceCountColumn ) {
+            switch( role ) {
+            case Qt::DisplayRole:
+                // types without instances are not part of the count query result
+                if ( d->countFailed )
+                    return i18nc( "@item the number of instances could not be determined", "n/a" );
+                else if ( d->instanceCounts.isEmpty() )
+                    return QVariant();
+                else
+                    return d->instanceCounts.value( node->type.uri(), 0 );
+
+            case Qt::ToolTipRole:
+                if ( d->countFailed )
+                    return i18n( "The instances could not be counted." );
+                else
+                    return QVariant();
+
+            case Qt::TextAlignmentRole:
+                return int( Qt::AlignRight|Qt::AlignVCenter );
+
+            case TypeRole:
+            case InstanceCountRole:
+                break;
+
+            default:
+                return QVariant();
+            }
+        }
+
         switch( role ) {
         case Qt::DisplayRole:
-            if ( index.column() == 0 ) {
-                return node->type.label();
-            }
-            else {
-                return node->type.comment();
-            }
+            return node->type.label();
 
         case Qt::ToolTipRole:
             return QString(QLatin1String( "<p>" ) + node->type.comment() + QLatin1String( "<br><i>" ) + node->type.uri().toString() + QLatin1String( "</i>" ));
@@ -292,6 +364,12 @@ QVariant Nepomuk2::Utils::ClassModel::data( const QModelIndex& index, int role )
         case TypeRole:
             return qVariantFromValue( node->type );
 
+        case InstanceCountRole:
+            if ( d->instanceCounts.isEmpty() )
+                return QVariant();
+            else
+                return d->instanceCounts.value( node->type.uri(), 0 );
+
         default:
             return QVariant();
         }
@@ -524,4 +602,94 @@ void Nepomuk2::Utils::ClassModel::updateClass( const Types::Class& type )
     }
 }
 
+
+void Nepomuk2::Utils::ClassModel::setInstanceCountMode( InstanceCountMode mode )
+{
+    if ( d->countMode != mode ) {
+        const bool columnCountChanged = ( d->countMode == NoInstanceCount || mode == NoInstanceCount );
+        d->countMode = mode;
+        d->closeCountQuery();
+        d->instanceCounts.clear();
+        if ( columnCountChanged ) {
+            reset();
+        }
+        updateInstanceCounts();
+    }
+}
+
+
+Nepomuk2::Utils::ClassModel::InstanceCountMode Nepomuk2::Utils::ClassModel::instanceCountMode() const
+{
+    return d->countMode;
+}
+
+
+void Nepomuk2::Utils::ClassModel::updateInstanceCounts()
+{
+    d->closeCountQuery();
+    d->countFailed = false;
+
+    if ( d->countMode == NoInstanceCount ) {
+        return;
+    }
+
+    // Count the instances of all types in one go instead of running one query per
+    // class. For the inferred counts we rely on the rdfs:subClassOf closure which
+    // is stored in the ontology graphs. A path expression would walk the hierarchy
+    // for every typed resource in the store.
+    QString query;
+    if ( d->countMode == DirectInstanceCount ) {
+        query = QString::fromLatin1( "select ?t (count(distinct ?r) as ?c) where { ?r %1 ?t . } group by ?t" )
+                .arg( Soprano::Node::resourceToN3( Soprano::Vocabulary::RDF::type() ) );
+    }
+    else {
+        query = QString::fromLatin1( "select ?t (count(distinct ?r) as ?c) where { "
+                                     "{ ?r %1 ?t . } UNION { ?r %1 ?st . ?st %2 ?t . } "
+                                     "} group by ?t" )
+                .arg( Soprano::Node::resourceToN3( Soprano::Vocabulary::RDF::type() ),
+                      Soprano::Node::resourceToN3( Soprano::Vocabulary::RDFS::subClassOf() ) );
+    }
+
+    d->countQuery = Soprano::Util::AsyncQuery::executeQuery( ResourceManager::instance()->mainModel(), query, Soprano::Query::QueryLanguageSparql );
+    connect( d->countQuery, SIGNAL(nextReady(Soprano::Util::AsyncQuery*)),
+             this, SLOT(slotCountQueryNextReady(Soprano::Util::AsyncQuery*)) );
+    connect( d->countQuery, SIGNAL(finished(Soprano::Util::AsyncQuery*)),
+             this, SLOT(slotCountQueryFinished(Soprano::Util::AsyncQuery*)) );
+}
+
+
+void Nepomuk2::Utils::ClassModel::slotCountQueryNextReady( Soprano::Util::AsyncQuery* query )
+{
+    d->pendingInstanceCounts.insert( query->binding( QLatin1String( "t" ) ).uri(),
+                                     query->binding( QLatin1String( "c" ) ).literal().toInt() );
+    query->next();
+}
+
+
+void Nepomuk2::Utils::ClassModel::slotCountQueryFinished( Soprano::Util::AsyncQuery* query )
+{
+    d->countQuery = 0;
+
+    if ( query->lastError() ) {
+        // updateInstanceCounts() can be used to try again
+        kDebug() << "Failed to count instances:" << query->lastError();
+        d->pendingInstanceCounts.clear();
+        d->instanceCounts.clear();
+        d->countFailed = true;
+    }
+    else {
+        // we update the counts in one batch to avoid flicker and useless repaints
+        d->instanceCounts = d->pendingInstanceCounts;
+        d->pendingInstanceCounts.clear();
+        d->countFailed = false;
+    }
+
+    if ( !d->baseClassNodes.isEmpty() ) {
+        emit dataChanged( index( 0, InstanceCountColumn ), index( d->baseClassNodes.count()-1, InstanceCountColumn ) );
+        Q_FOREACH( ClassNode* node, d->baseClassNodes ) {
+            d->emitCountsChanged( node );
+        }
+    }
+}
+
 #include "classmodel.moc"
@@ -23,6 +23,12 @@
 
 #include <QtCore/QAbstractItemModel>
 
+namespace Soprano {
+    namespace Util {
+        class AsyncQuery;
+    }
+}
+
 namespace Nepomuk2 {
     namespace Types {
         class Class;
@@ -41,6 +47,9 @@ namespace Nepomuk2 {
          * drag'n'drop allowing to create new rdfs:subclass relationsships
          * for user created types.
          *
+         * Optionally the model can show the number of instances of each type
+         * in a second column. See setInstanceCountMode().
+         *
          * \author Sebastian Trueg <trueg@kde.org>
          *
          * \since 4.6
@@ -69,9 +78,54 @@ namespace Nepomuk2 {
                  * The type the node represents, provided as a
                  * Nepomuk2::Types::Class instance.
                  */
-                TypeRole = 7777
+                TypeRole = 7777,
+
+                /**
+                 * The number of instances of the type as an int. Only
+                 * available once the instance counts have been fetched.
+                 * \sa setInstanceCountMode()
+                 */
+                InstanceCountRole = 7778
+            };
+
+            /**
+             * The columns provided by the model.
+             */
+            enum Columns {
+                /// The label and icon of the type
+                TypeColumn = 0,
+
+                /// The number of instances, only present if instance counts are enabled
+                InstanceCountColumn = 1
+            };
+
+            /**
+             * Determines how instances are counted.
+             */
+            enum InstanceCountMode {
+                /// No instance counts are fetched and the count column is hidden
+                NoInstanceCount,
+
+                /// Only count resources which have the type directly
+                DirectInstanceCount,
+
+                /// Include the instances of all subclasses
+                InferredInstanceCount
             };
 
+            /**
+             * Enable or disable the instance count column. The counts for all
+             * types are fetched in the background with a single aggregate query.
+             *
+             * Default: NoInstanceCount
+             */
+            void setInstanceCountMode( InstanceCountMode mode );
+
+            /**
+             * \return The mode set via setInstanceCountMode()
+             */
+            InstanceCountMode instanceCountMode() const;
+
             /**
              * \return The list of root classes as added via addRootClass() or
              * setRootClasses().
@@ -181,6 +235,18 @@ namespace Nepomuk2 {
              */
             void updateClass( const Types::Class& type );
 
+            /**
+             * Re-fetch the instance counts. Does nothing if instance counts
+             * are disabled.
+             *
+             * \sa setInstanceCountMode()
+             */
+            void updateInstanceCounts();
+
+        private Q_SLOTS:
+            void slotCountQueryNextReady( Soprano::Util::AsyncQuery* query );
+            void slotCountQueryFinished( Soprano::Util::AsyncQuery* query );
+
         private:
             bool canFetchMore( const QModelIndex& parent ) const;
             void fetchMore( const QModelIndex& parent );
@@ -0,0 +1,186 @@
+/*
+   Copyright (C) 2010 by Sebastian Trueg <trueg at kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "graphmetadatacache.h"
+
+#include <nepomuk2/resourcemanager.h>
+
+#include <Soprano/Model>
+#include <Soprano/Node>
+#include <Soprano/LiteralValue>
+#include <Soprano/Vocabulary/NAO>
+#include <Soprano/Util/AsyncQuery>
+
+#include <KGlobal>
+#include <KDebug>
+
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+
+
+namespace {
+/// The maximum number of graphs requested with one query
+const int s_batchSize = 200;
+
+struct GraphMetadata {
+    GraphMetadata() : failed( false ) {}
+    QDateTime creationDate;
+    QString agent;
+
+    /// true if the query failed, the graph is requested again with the next load()
+    bool failed;
+};
+}
+
+
+namespace Nepomuk2 {
+class GraphMetadataCacheHelper
+{
+public:
+    GraphMetadataCache q;
+};
+}
+K_GLOBAL_STATIC( Nepomuk2::GraphMetadataCacheHelper, s_cacheHelper )
+
+
+class Nepomuk2::GraphMetadataCache::Private
+{
+public:
+    QHash<QUrl, GraphMetadata> m_graphs;
+
+    /// the graphs requested by each running query
+    QHash<Soprano::Util::AsyncQuery*, QList<QUrl> > m_runningQueries;
+    QSet<QUrl> m_requestedGraphs;
+};
+
+
+Nepomuk2::GraphMetadataCache::GraphMetadataCache()
+    : QObject(),
+      d( new Private() )
+{
+}
+
+
+Nepomuk2::GraphMetadataCache::~GraphMetadataCache()
+{
+    Q_FOREACH( Soprano::Util::AsyncQuery* query, d->m_runningQueries.keys() ) {
+        query->disconnect( this );
+        query->close();
+    }
+    delete d;
+}
+
+
+Nepomuk2::GraphMetadataCache* Nepomuk2::GraphMetadataCache::self()
+{
+    return &s_cacheHelper->q;
+}
+
+
+bool Nepomuk2::GraphMetadataCache::contains( const QUrl& graph ) const
+{
+    return d->m_graphs.contains( graph );
+}
+
+
+QDateTime Nepomuk2::GraphMetadataCache::creationDate( const QUrl& graph ) const
+{
+    return d->m_graphs.value( graph ).creationDate;
+}
+
+
+QString Nepomuk2::GraphMetadataCache::agent( const QUrl& graph ) const
+{
+    return d->m_graphs.value( graph ).agent;
+}
+
+
+void Nepomuk2::GraphMetadataCache::load( const QList<QUrl>& graphs )
+{
+    QList<QUrl> newGraphs;
+    Q_FOREACH( const QUrl& graph, graphs ) {
+        QHash<QUrl, GraphMetadata>::const_iterator it = d->m_graphs.constFind( graph );
+        if( ( it == d->m_graphs.constEnd() || it->failed ) && !d->m_requestedGraphs.contains( graph ) ) {
+            d->m_requestedGraphs.insert( graph );
+            newGraphs << graph;
+        }
+    }
+
+    for( int i = 0; i < newGraphs.count(); i += s_batchSize ) {
+        const QList<QUrl> batch = newGraphs.mid( i, s_batchSize );
+        QStringList graphNodes;
+        Q_FOREACH( const QUrl& graph, batch ) {
+            graphNodes << Soprano::Node::resourceToN3( graph );
+        }
+
+        const QString query = QString::fromLatin1("select ?g ?d ?a where { ?g %1 ?d . "
+                                                  "OPTIONAL { ?g %2 ?r . ?r %3 ?a . } . "
+                                                  "FILTER(?g in (%4)) . }")
+                              .arg( Soprano::Node::resourceToN3( Soprano::Vocabulary::NAO::created() ),
+                                    Soprano::Node::resourceToN3( Soprano::Vocabulary::NAO::maintainedBy() ),
+                                    Soprano::Node::resourceToN3( Soprano::Vocabulary::NAO::identifier() ),
+                                    graphNodes.join( QLatin1String( "," ) ) );
+
+        Soprano::Util::AsyncQuery* asyncQuery
+            = Soprano::Util::AsyncQuery::executeQuery( ResourceManager::instance()->mainModel(),
+                                                       query,
+                                                       Soprano::Query::QueryLanguageSparql );
+        connect( asyncQuery, SIGNAL(nextReady(Soprano::Util::AsyncQuery*)),
+                 this, SLOT(slotNextResultReady(Soprano::Util::AsyncQuery*)) );
+        connect( asyncQuery, SIGNAL(finished(Soprano::Util::AsyncQuery*)),
+                 this, SLOT(slotQueryFinished(Soprano::Util::AsyncQuery*)) );
+        d->m_runningQueries.insert( asyncQuery, batch );
+    }
+}
+
+
+void Nepomuk2::GraphMetadataCache::slotNextResultReady( Soprano::Util::AsyncQuery* query )
+{
+    GraphMetadata& metadata = d->m_graphs[query->binding( QLatin1String( "g" ) ).uri()];
+    metadata.creationDate = query->binding( QLatin1String( "d" ) ).literal().toDateTime();
+    metadata.agent = query->binding( QLatin1String( "a" ) ).toString();
+    query->next();
+}
+
+
+void Nepomuk2::GraphMetadataCache::slotQueryFinished( Soprano::Util::AsyncQuery* query )
+{
+    const QList<QUrl> graphs = d->m_runningQueries.take( query );
+    const bool success = !query->lastError();
+    if( !success ) {
+        kDebug() << query->lastError();
+    }
+
+    // Graphs without metadata are still cached, there is nothing more to learn about them.
+    // Failed graphs are cached as well so they are shown as unknown instead of loading forever.
+    Q_FOREACH( const QUrl& graph, graphs ) {
+        d->m_requestedGraphs.remove( graph );
+        if( !d->m_graphs.contains( graph ) ) {
+            GraphMetadata metadata;
+            metadata.failed = !success;
+            d->m_graphs.insert( graph, metadata );
+        }
+    }
+
+    emit graphsLoaded( graphs );
+}
+
+#include "graphmetadatacache.moc"
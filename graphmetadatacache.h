@@ -0,0 +1,101 @@
+/*
+   Copyright (C) 2010 by Sebastian Trueg <trueg at kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _NEPOMUK_GRAPH_METADATA_CACHE_H_
+#define _NEPOMUK_GRAPH_METADATA_CACHE_H_
+
+#include <QtCore/QObject>
+#include <QtCore/QUrl>
+#include <QtCore/QList>
+#include <QtCore/QDateTime>
+
+namespace Soprano {
+    namespace Util {
+        class AsyncQuery;
+    }
+}
+
+namespace Nepomuk2 {
+    /**
+     * \class GraphMetadataCache graphmetadatacache.h
+     *
+     * \brief Process-wide cache of the creation date and agent of graphs.
+     *
+     * Most statements of a resource share a few graphs. Instead of joining
+     * the graph metadata for every single statement the metadata is loaded
+     * once per graph, with one query for any number of graphs.
+     *
+     * Graphs never change their metadata, thus, nothing is ever invalidated.
+     */
+    class GraphMetadataCache : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        ~GraphMetadataCache();
+
+        static GraphMetadataCache* self();
+
+        /**
+         * \return \p true if the metadata of \p graph has been loaded or
+         * loading it failed.
+         */
+        bool contains( const QUrl& graph ) const;
+
+        /**
+         * \return The creation date of \p graph or an invalid date if it
+         * has none or has not been loaded yet.
+         */
+        QDateTime creationDate( const QUrl& graph ) const;
+
+        /**
+         * \return The identifier of the agent maintaining \p graph or an empty
+         * string if not known.
+         */
+        QString agent( const QUrl& graph ) const;
+
+        /**
+         * Load the metadata of all graphs in \p graphs which are not cached yet.
+         * Graphs which failed to load before are requested again.
+         * This is done asynchronously, graphsLoaded() is emitted once done.
+         */
+        void load( const QList<QUrl>& graphs );
+
+    Q_SIGNALS:
+        /**
+         * Emitted once the metadata of \p graphs has been loaded.
+         */
+        void graphsLoaded( const QList<QUrl>& graphs );
+
+    private Q_SLOTS:
+        void slotNextResultReady( Soprano::Util::AsyncQuery* query );
+        void slotQueryFinished( Soprano::Util::AsyncQuery* query );
+
+    private:
+        GraphMetadataCache();
+
+        class Private;
+        Private* const d;
+
+        friend class GraphMetadataCacheHelper;
+    };
+}
+
+#endif
@@ -23,9 +23,12 @@
 #include "resourceview.h"
 #include "resourcebrowserwidget.h"
 #include "resourceeditorwidget.h"
+#include "resourcegraphwidget.h"
 #include "resourcequerywidget.h"
 #include "nepomukshellsettings.h"
 #include "resourcebrowsersettingspage.h"
+#include "resourcedeletejob.h"
+#include "prefixregistry.h"
 
 // Migrated classes
 #include "utils/resourcemodel.h"
@@ -49,6 +52,8 @@
 #include <KConfig>
 #include <KGlobal>
 #include <KFileDialog>
+#include <KIO/JobUiDelegate>
+#include <KJobTrackerInterface>
 
 #include <Soprano/Vocabulary/RDFS>
 #include <Nepomuk2/Vocabulary/PIMO>
@@ -56,8 +61,6 @@
 #include <Soprano/Model>
 #include <Soprano/Serializer>
 #include <Soprano/PluginManager>
-#define USING_SOPRANO_NRLMODEL_UNSTABLE_API
-#include <Soprano/NRLModel>
 
 
 MainWindow* MainWindow::s_self = 0;
@@ -81,6 +84,9 @@ MainWindow::MainWindow()
     m_resourceEditor = new ResourceEditorWidget( m_mainStack );
     m_mainStack->addWidget( m_resourceEditor );
 
+    m_resourceGraph = new ResourceGraphWidget( m_mainStack );
+    m_mainStack->addWidget( m_resourceGraph );
+
     setupActions();
 
     connect( m_resourceBrowser, SIGNAL(resourcesSelected(QList<Nepomuk2::Resource>)),
@@ -92,6 +98,8 @@ MainWindow::MainWindow()
              this, SLOT(slotResourceActivated(Nepomuk2::Resource)) );
     connect( m_resourceEditor, SIGNAL(resourceActivated(Nepomuk2::Resource)),
              this, SLOT(slotResourceActivated(Nepomuk2::Resource)) );
+    connect( m_resourceGraph, SIGNAL(resourceActivated(Nepomuk2::Resource)),
+             this, SLOT(slotResourceActivated(Nepomuk2::Resource)) );
 
     // init
     m_mainStack->setCurrentWidget( m_resourceBrowser );
@@ -185,11 +193,19 @@ void MainWindow::setupActions()
     actionCollection()->addAction( QLatin1String( "mode_edit" ), m_actionModeEdit );
     connect( m_actionModeEdit, SIGNAL(triggered()), this, SLOT(slotModeEdit()) );
 
+    m_actionModeGraph = new KToggleAction( actionCollection() );
+    m_actionModeGraph->setText( i18nc("@action:button", "Resource Graph") );
+    m_actionModeGraph->setIcon( KIcon( QLatin1String( "distribute-graph" ) ) );
+    m_actionModeGraph->setShortcut( Qt::ALT + Qt::Key_G );
+    actionCollection()->addAction( QLatin1String( "mode_graph" ), m_actionModeGraph );
+    connect( m_actionModeGraph, SIGNAL(triggered()), this, SLOT(slotModeGraph()) );
+
     QActionGroup* modeGroup = new QActionGroup( this );
     modeGroup->setExclusive( true );
     modeGroup->addAction( m_actionModeBrowse );
     modeGroup->addAction( m_actionModeQuery );
     modeGroup->addAction( m_actionModeEdit );
+    modeGroup->addAction( m_actionModeGraph );
 
 
     // resource actions
@@ -253,9 +269,24 @@ void MainWindow::slotModeEdit()
 }
 
 
+void MainWindow::slotModeGraph()
+{
+    kDebug();
+    if( m_resourceEditor->resource().isValid() ) {
+        m_resourceGraph->setResource( m_resourceEditor->resource() );
+    }
+    else if( selectedResources().count() == 1 ) {
+        m_resourceGraph->setResource( selectedResources().first() );
+    }
+
+    m_mainStack->setCurrentWidget( m_resourceGraph );
+}
+
+
 void MainWindow::slotResourcesSelected( const QList<Nepomuk2::Resource>& res )
 {
     m_actionModeEdit->setEnabled( res.count() == 1 || m_resourceEditor->resource().isValid() );
+    m_actionModeGraph->setEnabled( m_actionModeEdit->isEnabled() );
     m_resourceActionGroup->setEnabled( !res.isEmpty() );
 }
 
@@ -274,22 +305,42 @@ void MainWindow::slotDeleteResource()
         KMessageBox::sorry( this, i18n("No Resource to delete selected.") );
     }
     else {
+        // fetching the labels means loading each resource, thus, we only list the first few
+        const int maxListedResources = 50;
         QStringList resNames;
+        QList<QUrl> uris;
         Q_FOREACH( Nepomuk2::Resource res, rl ) {
-            resNames << res.genericLabel();
+            if( resNames.count() < maxListedResources )
+                resNames << res.genericLabel();
+            uris << res.uri();
+        }
+        if( rl.count() > maxListedResources ) {
+            resNames << i18np("... and one more resource", "... and %1 more resources", rl.count() - maxListedResources);
         }
         if( KMessageBox::questionYesNoList( this,
                                             i18n("Do you really want to delete these resources?"),
                                             resNames,
                                             i18nc("@title:window for a confirmation question", "Deleting Resources") ) == KMessageBox::Yes ) {
-            Q_FOREACH( Nepomuk2::Resource res, rl ) {
-                res.remove();
-            }
+            Nepomuk2::ResourceDeleteJob* job = new Nepomuk2::ResourceDeleteJob( uris, this );
+            connect( job, SIGNAL(resourcesRemoved(QList<QUrl>)),
+                     m_resourceBrowser, SLOT(removeResources(QList<QUrl>)) );
+            connect( job, SIGNAL(result(KJob*)),
+                     this, SLOT(slotDeleteResourceFinished(KJob*)) );
+            KIO::getJobTracker()->registerJob( job );
+            job->start();
         }
     }
 }
 
 
+void MainWindow::slotDeleteResourceFinished( KJob* job )
+{
+    if( job->error() && job->error() != KJob::KilledJobError ) {
+        KMessageBox::error( this, job->errorString(), i18n("Failed to delete resources") );
+    }
+}
+
+
 void MainWindow::slotSettings()
 {
     if( KConfigDialog::showDialog( QLatin1String( "settings") ) )
@@ -336,7 +387,6 @@ void MainWindow::slotAutoIndentQuery()
 void MainWindow::slotShowSource()
 {
     // TODO: create a dedicated dialog with buttons to change serialization and enable/disable bnames
-    //       for the latter put the NRLModel trick from the QueryModel into a helper class
     Soprano::StatementIterator it = Nepomuk2::ResourceManager::instance()->mainModel()->listStatements( selectedResources().first().uri(),
                                                                                                        Soprano::Node(),
                                                                                                        Soprano::Node() );
@@ -347,13 +397,9 @@ void MainWindow::slotShowSource()
     }
 
     // add query prefixes
-    // TODO: put this into a helper class
-    Soprano::NRLModel nrlModel( Nepomuk2::ResourceManager::instance()->mainModel() );
-    nrlModel.setEnableQueryPrefixExpansion( true );
-    QHash<QString, QUrl> queryPrefixes = nrlModel.queryPrefixes();
-    for( QHash<QString, QUrl>::const_iterator it = queryPrefixes.constBegin();
-         it != queryPrefixes.constEnd(); ++it ) {
-        serializer->addPrefix( it.key(), it.value() );
+    typedef QPair<QString, QUrl> Prefix;
+    Q_FOREACH( const Prefix& prefix, Nepomuk2::PrefixRegistry::self()->prefixes() ) {
+        serializer->addPrefix( prefix.first, prefix.second );
     }
 
     QString s;
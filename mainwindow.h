@@ -28,8 +28,10 @@
 #include "ui_mainwindow.h"
 
 class KAction;
+class KJob;
 class ResourceBrowserWidget;
 class ResourceEditorWidget;
+class ResourceGraphWidget;
 class ResourceQueryWidget;
 
 class MainWindow : public KXmlGuiWindow, private Ui::MainWindow
@@ -52,9 +54,11 @@ private Q_SLOTS:
     void slotModeBrowse();
     void slotModeQuery();
     void slotModeEdit();
+    void slotModeGraph();
     void slotResourcesSelected( const QList<Nepomuk2::Resource>& res );
     void slotResourceActivated( const Nepomuk2::Resource& res );
     void slotDeleteResource();
+    void slotDeleteResourceFinished( KJob* job );
     void slotSettings();
     void slotOpen();
     void slotShowSource();
@@ -70,6 +74,7 @@ private:
     ResourceBrowserWidget* m_resourceBrowser;
     ResourceQueryWidget* m_resourceQueryWidget;
     ResourceEditorWidget* m_resourceEditor;
+    ResourceGraphWidget* m_resourceGraph;
 
     KAction* m_actionNewSubClass;
     KAction* m_actionNewProperty;
@@ -79,6 +84,7 @@ private:
     KAction* m_actionModeBrowse;
     KAction* m_actionModeQuery;
     KAction* m_actionModeEdit;
+    KAction* m_actionModeGraph;
 
     KAction* m_actionDelete;
     KAction* m_actionShowSource;
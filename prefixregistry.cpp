@@ -0,0 +1,214 @@
+/*
+   Copyright (C) 2010 by Sebastian Trueg <trueg at kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "prefixregistry.h"
+#include "sparqltokenizer.h"
+
+#include <nepomuk2/resourcemanager.h>
+
+#define USING_SOPRANO_NRLMODEL_UNSTABLE_API
+#include <Soprano/NRLModel>
+
+#include <KGlobal>
+
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+#include <QtCore/QtAlgorithms>
+
+
+namespace Nepomuk2 {
+class PrefixRegistryHelper
+{
+public:
+    PrefixRegistry q;
+};
+}
+K_GLOBAL_STATIC( Nepomuk2::PrefixRegistryHelper, s_registryHelper )
+
+
+namespace {
+    template<typename T>
+    struct NamespaceLessThan {
+        bool operator()( const T& e1, const T& e2 ) const { return e1.ns < e2.ns; }
+        bool operator()( const T& e, const QString& ns ) const { return e.ns < ns; }
+        bool operator()( const QString& ns, const T& e ) const { return ns < e.ns; }
+    };
+
+    template<typename T>
+    struct PrefixLessThan {
+        bool operator()( const T& e1, const T& e2 ) const { return e1.prefix < e2.prefix; }
+        bool operator()( const T& e, const QString& prefix ) const { return e.prefix < prefix; }
+        bool operator()( const QString& prefix, const T& e ) const { return prefix < e.prefix; }
+    };
+}
+
+
+Nepomuk2::PrefixRegistry::PrefixRegistry()
+{
+    Soprano::NRLModel nrlModel( ResourceManager::instance()->mainModel() );
+    nrlModel.setEnableQueryPrefixExpansion( true );
+    const QHash<QString, QUrl> queryPrefixes = nrlModel.queryPrefixes();
+    for( QHash<QString, QUrl>::const_iterator it = queryPrefixes.constBegin();
+         it != queryPrefixes.constEnd(); ++it ) {
+        Entry entry;
+        entry.prefix = it.key();
+        entry.ns = it.value().toString();
+        m_byNamespace.append( entry );
+    }
+
+    m_byPrefix = m_byNamespace;
+    qSort( m_byNamespace.begin(), m_byNamespace.end(), NamespaceLessThan<Entry>() );
+    qSort( m_byPrefix.begin(), m_byPrefix.end(), PrefixLessThan<Entry>() );
+}
+
+
+Nepomuk2::PrefixRegistry::~PrefixRegistry()
+{
+}
+
+
+Nepomuk2::PrefixRegistry* Nepomuk2::PrefixRegistry::self()
+{
+    return &s_registryHelper->q;
+}
+
+
+QString Nepomuk2::PrefixRegistry::prefix( const QString& ns ) const
+{
+    QVector<Entry>::const_iterator it = qLowerBound( m_byNamespace.constBegin(), m_byNamespace.constEnd(),
+                                                     ns, NamespaceLessThan<Entry>() );
+    if( it != m_byNamespace.constEnd() && it->ns == ns )
+        return it->prefix;
+    else
+        return QString();
+}
+
+
+QString Nepomuk2::PrefixRegistry::toCurie( const QUrl& uri ) const
+{
+    // All ontology namespaces end in '#' or '/'
+    const QString uriStr = uri.toString();
+    const int i = qMax( uriStr.lastIndexOf( QLatin1Char( '#' ) ), uriStr.lastIndexOf( QLatin1Char( '/' ) ) ) + 1;
+    if( i <= 0 || i >= uriStr.length() )
+        return QString();
+
+    const QString prefix = this->prefix( uriStr.left( i ) );
+    if( prefix.isEmpty() )
+        return QString();
+    else
+        return prefix + QLatin1Char( ':' ) + uriStr.mid( i );
+}
+
+
+QUrl Nepomuk2::PrefixRegistry::toUri( const QString& curie ) const
+{
+    const int i = curie.indexOf( QLatin1Char( ':' ) );
+    if( i < 0 )
+        return QUrl();
+
+    const QString prefix = curie.left( i );
+    QVector<Entry>::const_iterator it = qLowerBound( m_byPrefix.constBegin(), m_byPrefix.constEnd(),
+                                                     prefix, PrefixLessThan<Entry>() );
+    if( it != m_byPrefix.constEnd() && it->prefix == prefix )
+        return QUrl( it->ns + curie.mid( i + 1 ) );
+    else
+        return QUrl();
+}
+
+
+QList<QPair<QString, QUrl> > Nepomuk2::PrefixRegistry::prefixes() const
+{
+    QList<QPair<QString, QUrl> > result;
+    Q_FOREACH( const Entry& entry, m_byPrefix ) {
+        result << qMakePair( entry.prefix, QUrl( entry.ns ) );
+    }
+    return result;
+}
+
+
+QString Nepomuk2::PrefixRegistry::addPrefixDeclarations( const QString& query ) const
+{
+    QSet<QString> declared;
+    QStringList used;
+
+    // Virtuoso expects its DEFINE pragmas in front of everything else. Thus, the
+    // declarations go after the leading DEFINE and BASE clauses.
+    int insertPosition = 0;
+    bool inPragmas = true;
+    int pragmaTerms = 0;
+
+    SparqlTokenizer tokenizer( query );
+    bool afterPrefixKeyword = false;
+    SparqlTokenizer::Token token;
+    while( ( token = tokenizer.next() ).type != SparqlTokenizer::End ) {
+        if( token.type == SparqlTokenizer::Comment )
+            continue;
+
+        if( inPragmas ) {
+            const QString text = tokenizer.text( token );
+            if( pragmaTerms > 0 ) {
+                --pragmaTerms;
+                insertPosition = token.start + token.length;
+                continue;
+            }
+            else if( text.compare( QLatin1String( "define" ), Qt::CaseInsensitive ) == 0 ) {
+                // DEFINE name value
+                pragmaTerms = 2;
+                insertPosition = token.start + token.length;
+                continue;
+            }
+            else if( text.compare( QLatin1String( "base" ), Qt::CaseInsensitive ) == 0 ) {
+                // BASE <iri>
+                pragmaTerms = 1;
+                insertPosition = token.start + token.length;
+                continue;
+            }
+            inPragmas = false;
+        }
+
+        if( token.type == SparqlTokenizer::PrefixedName ) {
+            const QString text = tokenizer.text( token );
+            const QString prefix = text.left( text.indexOf( QLatin1Char( ':' ) ) );
+            if( afterPrefixKeyword )
+                declared.insert( prefix );
+            else if( !used.contains( prefix ) )
+                used << prefix;
+        }
+        afterPrefixKeyword = ( token.type == SparqlTokenizer::Keyword &&
+                               tokenizer.text( token ).compare( QLatin1String( "prefix" ), Qt::CaseInsensitive ) == 0 );
+    }
+
+    QString declarations;
+    Q_FOREACH( const QString& prefix, used ) {
+        if( declared.contains( prefix ) )
+            continue;
+        const QUrl ns = toUri( prefix + QLatin1Char( ':' ) );
+        if( ns.isValid() && !ns.isEmpty() )
+            declarations += QString::fromLatin1( "PREFIX %1: <%2>\n" ).arg( prefix, ns.toString() );
+    }
+
+    if( declarations.isEmpty() )
+        return query;
+    else if( insertPosition == 0 )
+        return declarations + query;
+    else
+        return query.left( insertPosition ) + QLatin1Char( '\n' ) + declarations + query.mid( insertPosition );
+}
@@ -0,0 +1,95 @@
+/*
+   Copyright (C) 2010 by Sebastian Trueg <trueg at kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _NEPOMUK_PREFIX_REGISTRY_H_
+#define _NEPOMUK_PREFIX_REGISTRY_H_
+
+#include <QtCore/QUrl>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+#include <QtCore/QPair>
+
+namespace Nepomuk2 {
+    /**
+     * \class PrefixRegistry prefixregistry.h
+     *
+     * \brief Process-wide table of the query prefixes of the installed ontologies.
+     *
+     * The prefixes are read once through Soprano::NRLModel::queryPrefixes() and
+     * never change afterwards. They are kept in two arrays, one sorted by
+     * namespace and one sorted by prefix, which are searched with a binary search.
+     */
+    class PrefixRegistry
+    {
+    public:
+        ~PrefixRegistry();
+
+        static PrefixRegistry* self();
+
+        /**
+         * \return \p uri as prefixed name, for example "nao:Tag", or an empty
+         * string if its namespace has no prefix.
+         */
+        QString toCurie( const QUrl& uri ) const;
+
+        /**
+         * \return The full URI of the prefixed name \p curie or an invalid URI
+         * if its prefix is unknown.
+         */
+        QUrl toUri( const QString& curie ) const;
+
+        /**
+         * \return The prefix of the namespace \p ns, without the colon, or an
+         * empty string.
+         */
+        QString prefix( const QString& ns ) const;
+
+        /**
+         * \return All namespaces with their prefixes, sorted by prefix.
+         */
+        QList<QPair<QString, QUrl> > prefixes() const;
+
+        /**
+         * Add PREFIX declarations for all prefixes which are used but not
+         * declared in \p query. Thus, the query does not depend on the store
+         * expanding the prefixes. The declarations are inserted after
+         * leading DEFINE pragmas and BASE declarations.
+         */
+        QString addPrefixDeclarations( const QString& query ) const;
+
+    private:
+        PrefixRegistry();
+
+        struct Entry {
+            QString ns;
+            QString prefix;
+        };
+
+        /// sorted by namespace
+        QVector<Entry> m_byNamespace;
+
+        /// sorted by prefix
+        QVector<Entry> m_byPrefix;
+
+        friend class PrefixRegistryHelper;
+    };
+}
+
+#endif
@@ -21,21 +21,71 @@
 
 #include "queryeditor.h"
 #include "sparqlsyntaxhighlighter.h"
+#include "prefixregistry.h"
+#include "sparqltokenizer.h"
 
 #include <QtGui/QStringListModel>
 #include <QtGui/QCursor>
 #include <QtGui/QKeyEvent>
+#include <QtGui/QResizeEvent>
 #include <QtGui/QScrollBar>
+#include <QtGui/QHelpEvent>
+#include <QtGui/QToolTip>
+#include <QtGui/QTextBlock>
+#include <QtCore/QtConcurrentRun>
 
 #include <KGlobalSettings>
 #include <KDebug>
 
 #include <Soprano/Model>
-#include <Soprano/QueryResultIterator>
+#include <Soprano/Node>
+#include <Soprano/LiteralValue>
+#include <Soprano/Vocabulary/RDF>
+#include <Soprano/Vocabulary/RDFS>
+#include <Soprano/Vocabulary/NRL>
+#include <Soprano/Vocabulary/NAO>
+#include <Soprano/Util/AsyncQuery>
 
 #include <Nepomuk2/ResourceManager>
 
-QueryEditor::QueryEditor(QWidget* parent): KTextEdit(parent)
+#include <KStandardDirs>
+
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+
+
+namespace {
+/// Increase whenever the format of the completion cache changes
+const int s_completionCacheVersion = 2;
+
+/// The time in msecs after the last edit before the syntax is checked
+const int s_validationDelay = 300;
+
+/// The maximum number of syntax errors to underline
+const int s_maxShownSyntaxErrors = 100;
+
+/// A triple pattern never spans more lines than this, further back we do not look for its start
+const int s_maxPatternBlocks = 50;
+
+/// The state of the tokenizer at the beginning of \p block as stored by the highlighter
+Nepomuk2::SparqlTokenizer::State startState( const QTextBlock& block )
+{
+    const QTextBlock previous = block.previous();
+    if( previous.isValid() && previous.userState() >= 0 )
+        return Nepomuk2::SparqlTokenizer::State( previous.userState() );
+    else
+        return Nepomuk2::SparqlTokenizer::NormalState;
+}
+
+QString completionCacheFile()
+{
+    return KStandardDirs::locateLocal( "cache", QLatin1String( "nepomukshell/completioncandidates" ) );
+}
+}
+
+QueryEditor::QueryEditor(QWidget* parent)
+    : KTextEdit(parent),
+      m_validationRevision(-1)
 {
     setFont( KGlobalSettings::fixedFont() );
     setAcceptRichText( false );
@@ -44,42 +94,47 @@ QueryEditor::QueryEditor(QWidget* parent): KTextEdit(parent)
 
     m_highlighter = new Nepomuk2::SparqlSyntaxHighlighter( document() );
 
+    // Large queries are only highlighted where they are visible right away
+    connect( verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(slotUpdateVisibleBlocks()) );
+    connect( this, SIGNAL(textChanged()), this, SLOT(slotUpdateVisibleBlocks()) );
+
+    // Syntax errors are underlined without sending the query to the store
+    m_validationTimer.setSingleShot( true );
+    m_validationTimer.setInterval( s_validationDelay );
+    connect( this, SIGNAL(textChanged()), &m_validationTimer, SLOT(start()) );
+    connect( &m_validationTimer, SIGNAL(timeout()), this, SLOT(slotStartValidation()) );
+    connect( &m_validationWatcher, SIGNAL(finished()), this, SLOT(slotValidationFinished()) );
+
     //
     // Completion
     //
-    QString query = QString::fromLatin1("select ?pre ?r where { graph ?g {?r a ?t.} ?g nao:hasDefaultNamespaceAbbreviation ?pre. }");
-
-    Soprano::Model * model = Nepomuk2::ResourceManager::instance()->mainModel();
-    Soprano::QueryResultIterator it = model->executeQuery( query, Soprano::Query::QueryLanguageSparql );
-
-    QStringList candidates;
-    while( it.next() ) {
-        QString prefix = it[QLatin1String("pre")].toString();
-        QString res = it[QLatin1String("r")].uri().toString();
-        res = res.mid( res.lastIndexOf(QLatin1String( "#" )) + 1 );
-
-        candidates << QString( prefix + QLatin1String( ":" ) + res );
-    }
-
-    // Keywords
-    candidates << QLatin1String( "prefix" ) << QLatin1String( "select" ) << QLatin1String( "distinct" ) << QLatin1String( "reduced" )
-               << QLatin1String( "construct" ) << QLatin1String( "describe" ) << QLatin1String( "ask" ) << QLatin1String( "from" )
-               << QLatin1String( "named" ) << QLatin1String( "where" ) << QLatin1String( "order" ) << QLatin1String( "by" ) << QLatin1String( "asc" )
-               << QLatin1String( "desc" ) << QLatin1String( "limit" ) << QLatin1String( "offset" ) << QLatin1String( "optional" )
-               << QLatin1String( "graph" ) << QLatin1String( "union" ) << QLatin1String( "filter" ) << QLatin1String( "str" )
-               << QLatin1String( "lang" ) << QLatin1String( "langmatches" ) << QLatin1String( "datatype" ) << QLatin1String( "bound" )
-               << QLatin1String( "sameTerm" ) << QLatin1String( "isIRI" ) << QLatin1String( "isURI" ) << QLatin1String( "isLiteral" )
-               << QLatin1String( "isBlank" ) << QLatin1String( "regex" ) << QLatin1String( "true" ) << QLatin1String( "false" );
-
+    m_completionModel = new QStringListModel( this );
     m_completer = new QCompleter( this );
-    m_completer->setModel( new QStringListModel( candidates, m_completer ) );
-    m_completer->setModelSorting( QCompleter::CaseSensitivelySortedModel );
+    m_completer->setModel( m_completionModel );
     m_completer->setCaseSensitivity( Qt::CaseInsensitive );
 
+    // The candidates are already filtered and ranked by the completion engine
     m_completer->setWidget( this );
-    m_completer->setCompletionMode( QCompleter::PopupCompletion );
+    m_completer->setCompletionMode( QCompleter::UnfilteredPopupCompletion );
 
     connect( m_completer, SIGNAL(activated(QString)), this, SLOT(insertCompletion(QString)) );
+
+    // The ontology terms are cached between sessions. We only reload them in the background
+    // if the ontologies changed, which is checked with a very cheap query.
+    if( readCompletionCache() )
+        m_completionEngine.setOntologyTerms( m_ontologyClasses, m_ontologyProperties );
+
+    const QString query = QString::fromLatin1("select (count(?g) as ?c) (max(?d) as ?m) where { ?g a %1 . OPTIONAL { ?g %2 ?d . } . }")
+                          .arg( Soprano::Node::resourceToN3( Soprano::Vocabulary::NRL::Ontology() ),
+                                Soprano::Node::resourceToN3( Soprano::Vocabulary::NAO::lastModified() ) );
+    Soprano::Util::AsyncQuery* stampQuery
+        = Soprano::Util::AsyncQuery::executeQuery( Nepomuk2::ResourceManager::instance()->mainModel(),
+                                                   query,
+                                                   Soprano::Query::QueryLanguageSparql );
+    connect( stampQuery, SIGNAL(nextReady(Soprano::Util::AsyncQuery*)),
+             this, SLOT(slotOntologyStampReady(Soprano::Util::AsyncQuery*)) );
+    connect( stampQuery, SIGNAL(finished(Soprano::Util::AsyncQuery*)),
+             this, SLOT(slotOntologyStampQueryFinished(Soprano::Util::AsyncQuery*)) );
 }
 
 void QueryEditor::keyPressEvent(QKeyEvent* e)
@@ -105,11 +160,21 @@ void QueryEditor::keyPressEvent(QKeyEvent* e)
         m_completer->popup()->hide();
         return;
     }
-    // Select first completion as default completion in the list.
-    if (text != m_completer->completionPrefix()) {
-        m_completer->setCompletionPrefix(text);
-        m_completer->popup()->setCurrentIndex(m_completer->completionModel()->index(0, 0));
+    // only the lines around the cursor and the prolog are looked at, never the whole query
+    const bool isVariable = ( text.startsWith( QLatin1Char( '?' ) ) || text.startsWith( QLatin1Char( '$' ) ) );
+    const QStringList candidates = m_completionEngine.complete( completionPosition( textCursor().position() - text.length() ),
+                                                                isVariable ? m_highlighter->variables() : QStringList(),
+                                                                isVariable ? QStringList() : declaredPrefixes(),
+                                                                text );
+    if( candidates.isEmpty() ) {
+        m_completer->popup()->hide();
+        return;
     }
+    m_completionModel->setStringList( candidates );
+    m_completer->setCompletionPrefix( text );
+
+    // Select first completion as default completion in the list.
+    m_completer->popup()->setCurrentIndex( m_completer->completionModel()->index(0, 0) );
 
     QRect cr = cursorRect();
     cr.setWidth( m_completer->popup()->sizeHintForColumn(0)
@@ -118,6 +183,155 @@ void QueryEditor::keyPressEvent(QKeyEvent* e)
 }
 
 
+void QueryEditor::resizeEvent(QResizeEvent* e)
+{
+    KTextEdit::resizeEvent(e);
+    slotUpdateVisibleBlocks();
+}
+
+
+void QueryEditor::slotUpdateVisibleBlocks()
+{
+    const int first = cursorForPosition( QPoint( 0, 0 ) ).blockNumber();
+    const int last = cursorForPosition( QPoint( 0, viewport()->height() ) ).blockNumber();
+    m_highlighter->setVisibleBlocks( first, last );
+}
+
+
+bool QueryEditor::viewportEvent(QEvent* e)
+{
+    if( e->type() == QEvent::ToolTip ) {
+        QHelpEvent* helpEvent = static_cast<QHelpEvent*>( e );
+        const int pos = cursorForPosition( helpEvent->pos() ).position();
+        Q_FOREACH( const Nepomuk2::SparqlSyntaxError& error, m_syntaxErrors ) {
+            if( pos >= error.position && pos <= error.position + error.length ) {
+                QToolTip::showText( helpEvent->globalPos(), error.message(), viewport() );
+                return true;
+            }
+        }
+        QToolTip::hideText();
+    }
+    return KTextEdit::viewportEvent(e);
+}
+
+
+void QueryEditor::slotStartValidation()
+{
+    // the finished validation starts the next one if the text changed meanwhile
+    if( m_validationWatcher.isRunning() )
+        return;
+
+    m_validationRevision = document()->revision();
+    m_validationWatcher.setFuture( QtConcurrent::run( &Nepomuk2::SparqlValidator::validate, toPlainText() ) );
+}
+
+
+void QueryEditor::slotValidationFinished()
+{
+    // outdated results are simply dropped
+    if( m_validationRevision != document()->revision() ) {
+        m_validationTimer.start();
+        return;
+    }
+
+    m_syntaxErrors = m_validationWatcher.result();
+
+    QList<QTextEdit::ExtraSelection> selections;
+    for( int i = 0; i < m_syntaxErrors.count() && i < s_maxShownSyntaxErrors; ++i ) {
+        const Nepomuk2::SparqlSyntaxError& error = m_syntaxErrors[i];
+        QTextEdit::ExtraSelection selection;
+        selection.cursor = QTextCursor( document() );
+        selection.cursor.setPosition( error.position );
+        selection.cursor.setPosition( error.position + qMax( error.length, 1 ), QTextCursor::KeepAnchor );
+        selection.format.setUnderlineStyle( QTextCharFormat::WaveUnderline );
+        selection.format.setUnderlineColor( Qt::red );
+        selections << selection;
+    }
+    setExtraSelections( selections );
+}
+
+
+Nepomuk2::SparqlCompletionEngine::Position QueryEditor::completionPosition( int wordStart ) const
+{
+    // The current triple pattern starts at the last separator in front of the word. We look for
+    // it block by block backwards. Each block is tokenized starting with the state the highlighter
+    // stored for the previous one, thus, separators in strings spanning lines are skipped.
+    // Blocks still pending in the highlighter only have a guessed state, they are highlighted first.
+    Nepomuk2::SparqlCompletionEngine::Position position;
+    QTextBlock block = document()->findBlock( wordStart );
+    m_highlighter->highlightPendingBlocks( qMax( 0, block.blockNumber() - s_maxPatternBlocks ), block.blockNumber() );
+    for( int i = 0; block.isValid() && i < s_maxPatternBlocks; ++i, block = block.previous() ) {
+        QString text = block.text();
+        if( i == 0 )
+            text.truncate( wordStart - block.position() );
+
+        Nepomuk2::SparqlTokenizer tokenizer( text, startState( block ) );
+        Nepomuk2::SparqlTokenizer::Token token;
+        QStringList terms;
+        QChar separator;
+        while( ( token = tokenizer.next() ).type != Nepomuk2::SparqlTokenizer::End ) {
+            if( token.type == Nepomuk2::SparqlTokenizer::Comment )
+                continue;
+
+            const QString term = tokenizer.text( token );
+            if( token.type == Nepomuk2::SparqlTokenizer::Punctuation &&
+                QString::fromLatin1( "{}.;," ).contains( term ) ) {
+                separator = term[0];
+                terms.clear();
+            }
+            else {
+                terms << term;
+            }
+        }
+        position.terms = terms + position.terms;
+
+        if( !separator.isNull() ) {
+            position.inGroup = true;
+            if( separator == QLatin1Char( ';' ) )
+                position.terms.prepend( QString() );
+            else if( separator == QLatin1Char( ',' ) )
+                position.terms = QStringList() << QString() << QString() << position.terms;
+            return position;
+        }
+    }
+
+    // the beginning of the query without any separator is the header
+    position.inGroup = block.isValid();
+    return position;
+}
+
+
+QStringList QueryEditor::declaredPrefixes() const
+{
+    // The prefixes are declared in the prolog which ends at the first group. That is
+    // at the very beginning of the query. We tokenize from there on and carry the state
+    // over ourselves, the highlighter might not have reached these blocks yet.
+    QStringList prefixes;
+    bool afterPrefixKeyword = false;
+    Nepomuk2::SparqlTokenizer::State state = Nepomuk2::SparqlTokenizer::NormalState;
+    for( QTextBlock block = document()->begin(); block.isValid(); block = block.next() ) {
+        Nepomuk2::SparqlTokenizer tokenizer( block.text(), state );
+        Nepomuk2::SparqlTokenizer::Token token;
+        while( ( token = tokenizer.next() ).type != Nepomuk2::SparqlTokenizer::End ) {
+            const QString term = tokenizer.text( token );
+            if( token.type == Nepomuk2::SparqlTokenizer::Comment ) {
+                continue;
+            }
+            else if( token.type == Nepomuk2::SparqlTokenizer::Punctuation && term == QLatin1String( "{" ) ) {
+                return prefixes;
+            }
+            else if( afterPrefixKeyword && token.type == Nepomuk2::SparqlTokenizer::PrefixedName ) {
+                prefixes << term;
+            }
+            afterPrefixKeyword = ( token.type == Nepomuk2::SparqlTokenizer::Keyword &&
+                                   term.compare( QLatin1String( "prefix" ), Qt::CaseInsensitive ) == 0 );
+        }
+        state = tokenizer.state();
+    }
+    return prefixes;
+}
+
+
 QString QueryEditor::wordUnderCursor()
 {
     static QString eow = QLatin1String( "~!@#$%^&*()+{}|\"<>,./;'[]\\-= " ); // everything without ':', '?' and '_'
@@ -135,14 +349,132 @@ QString QueryEditor::wordUnderCursor()
     return tc.selectedText();
 }
 
+bool QueryEditor::readCompletionCache()
+{
+    QFile file( completionCacheFile() );
+    if( !file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    QTextStream stream( &file );
+    stream.setCodec( "UTF-8" );
+    if( stream.readLine().toInt() != s_completionCacheVersion )
+        return false;
+
+    // one "c<tab>prefix:term" or "p<tab>prefix:term" line per class or property
+    m_ontologyStamp = stream.readLine();
+    m_ontologyClasses.clear();
+    m_ontologyProperties.clear();
+    while( !stream.atEnd() ) {
+        const QString line = stream.readLine();
+        if( line.startsWith( QLatin1String( "c\t" ) ) )
+            m_ontologyClasses << line.mid( 2 );
+        else if( line.startsWith( QLatin1String( "p\t" ) ) )
+            m_ontologyProperties << line.mid( 2 );
+    }
+    return true;
+}
+
+
+void QueryEditor::writeCompletionCache()
+{
+    QFile file( completionCacheFile() );
+    if( !file.open( QIODevice::WriteOnly|QIODevice::Truncate ) ) {
+        kDebug() << "Failed to write completion cache" << file.fileName();
+        return;
+    }
+
+    QTextStream stream( &file );
+    stream.setCodec( "UTF-8" );
+    stream << s_completionCacheVersion << '\n'
+           << m_ontologyStamp << '\n';
+    Q_FOREACH( const QString& term, m_ontologyClasses ) {
+        stream << "c\t" << term << '\n';
+    }
+    Q_FOREACH( const QString& term, m_ontologyProperties ) {
+        stream << "p\t" << term << '\n';
+    }
+}
+
+
+void QueryEditor::slotOntologyStampReady( Soprano::Util::AsyncQuery* query )
+{
+    m_loadingOntologyStamp = query->binding( QLatin1String( "c" ) ).toString()
+                             + QLatin1Char( ' ' )
+                             + query->binding( QLatin1String( "m" ) ).toString();
+    query->next();
+}
+
+
+void QueryEditor::slotOntologyStampQueryFinished( Soprano::Util::AsyncQuery* query )
+{
+    if( query->lastError() ) {
+        kDebug() << query->lastError();
+        return;
+    }
+
+    if( m_loadingOntologyStamp == m_ontologyStamp && !m_ontologyProperties.isEmpty() )
+        return;
+
+    // Only classes and properties of the ontologies, not every typed entity in any graph
+    const QString candidateQuery
+        = QString::fromLatin1("select distinct ?r ?t where { graph ?g { ?r a ?t . } . "
+                              "?g a %1 . FILTER(?t in (%2,%3)) . }")
+          .arg( Soprano::Node::resourceToN3( Soprano::Vocabulary::NRL::Ontology() ),
+                Soprano::Node::resourceToN3( Soprano::Vocabulary::RDFS::Class() ),
+                Soprano::Node::resourceToN3( Soprano::Vocabulary::RDF::Property() ) );
+
+    m_loadingOntologyClasses.clear();
+    m_loadingOntologyProperties.clear();
+    Soprano::Util::AsyncQuery* candidates
+        = Soprano::Util::AsyncQuery::executeQuery( Nepomuk2::ResourceManager::instance()->mainModel(),
+                                                   candidateQuery,
+                                                   Soprano::Query::QueryLanguageSparql );
+    connect( candidates, SIGNAL(nextReady(Soprano::Util::AsyncQuery*)),
+             this, SLOT(slotCandidateReady(Soprano::Util::AsyncQuery*)) );
+    connect( candidates, SIGNAL(finished(Soprano::Util::AsyncQuery*)),
+             this, SLOT(slotCandidateQueryFinished(Soprano::Util::AsyncQuery*)) );
+}
+
+
+void QueryEditor::slotCandidateReady( Soprano::Util::AsyncQuery* query )
+{
+    // terms of ontologies without a query prefix cannot be completed
+    const QString term = Nepomuk2::PrefixRegistry::self()->toCurie( query->binding( QLatin1String("r") ).uri() );
+    if( !term.isEmpty() ) {
+        if( query->binding( QLatin1String("t") ).uri() == Soprano::Vocabulary::RDFS::Class() )
+            m_loadingOntologyClasses << term;
+        else
+            m_loadingOntologyProperties << term;
+    }
+    query->next();
+}
+
+
+void QueryEditor::slotCandidateQueryFinished( Soprano::Util::AsyncQuery* query )
+{
+    if( query->lastError() ) {
+        kDebug() << query->lastError();
+        return;
+    }
+
+    m_ontologyClasses = m_loadingOntologyClasses;
+    m_ontologyProperties = m_loadingOntologyProperties;
+    m_ontologyStamp = m_loadingOntologyStamp;
+    m_loadingOntologyClasses.clear();
+    m_loadingOntologyProperties.clear();
+    m_completionEngine.setOntologyTerms( m_ontologyClasses, m_ontologyProperties );
+    writeCompletionCache();
+}
+
+
 void QueryEditor::insertCompletion(const QString& completion)
 {
+    // Replace the whole word since the completion may also have matched
+    // the local name only, i.e. "hasTag" completed to "nao:hasTag".
     QTextCursor tc = textCursor();
-    int extra = completion.length() - m_completer->completionPrefix().length();
-    tc.movePosition(QTextCursor::Left);
-    tc.movePosition(QTextCursor::EndOfWord);
-    tc.insertText(completion.right(extra));
-    setTextCursor(tc);
+    tc.movePosition( QTextCursor::Left, QTextCursor::KeepAnchor, m_completer->completionPrefix().length() );
+    tc.insertText( completion );
+    setTextCursor( tc );
 }
 
 
@@ -24,10 +24,21 @@
 
 #include <KTextEdit>
 #include <QtGui/QCompleter>
+#include <QtCore/QTimer>
+#include <QtCore/QFutureWatcher>
+
+#include "sparqlcompletionengine.h"
+#include "sparqlvalidator.h"
 
 namespace Nepomuk2 {
     class SparqlSyntaxHighlighter;
 }
+namespace Soprano {
+    namespace Util {
+        class AsyncQuery;
+    }
+}
+class QStringListModel;
 
 class QueryEditor : public KTextEdit
 {
@@ -37,14 +48,56 @@ public:
 
     virtual void keyPressEvent(QKeyEvent* e);
 
+    /**
+     * The syntax errors found in the last check of the query.
+     */
+    QList<Nepomuk2::SparqlSyntaxError> syntaxErrors() const { return m_syntaxErrors; }
+
+protected:
+    virtual void resizeEvent(QResizeEvent* e);
+    virtual bool viewportEvent(QEvent* e);
+
 private slots:
     void insertCompletion( const QString & text );
+    void slotUpdateVisibleBlocks();
+    void slotStartValidation();
+    void slotValidationFinished();
+    void slotOntologyStampReady( Soprano::Util::AsyncQuery* query );
+    void slotOntologyStampQueryFinished( Soprano::Util::AsyncQuery* query );
+    void slotCandidateReady( Soprano::Util::AsyncQuery* query );
+    void slotCandidateQueryFinished( Soprano::Util::AsyncQuery* query );
     
 private:
     QCompleter * m_completer;
+    QStringListModel* m_completionModel;
     Nepomuk2::SparqlSyntaxHighlighter* m_highlighter;
+    Nepomuk2::SparqlCompletionEngine m_completionEngine;
+
+    /// The prefix:term candidates of all ontologies
+    QStringList m_ontologyClasses;
+    QStringList m_ontologyProperties;
+    QStringList m_loadingOntologyClasses;
+    QStringList m_loadingOntologyProperties;
+
+    /// Identifies the state of the ontologies the terms were loaded from
+    QString m_ontologyStamp;
+    QString m_loadingOntologyStamp;
+
+    /// The syntax is checked in a worker thread shortly after the last edit
+    QTimer m_validationTimer;
+    QFutureWatcher<QList<Nepomuk2::SparqlSyntaxError> > m_validationWatcher;
+    int m_validationRevision;
+    QList<Nepomuk2::SparqlSyntaxError> m_syntaxErrors;
 
     QString wordUnderCursor();
+
+    /// where in the query the word starting at \p wordStart is, for the completion
+    Nepomuk2::SparqlCompletionEngine::Position completionPosition( int wordStart ) const;
+
+    /// the prefixes declared in the prolog of the query
+    QStringList declaredPrefixes() const;
+    bool readCompletionCache();
+    void writeCompletionCache();
 };
 
 #endif // QUERYEDITOR_H
@@ -0,0 +1,349 @@
+/*
+   Copyright (c) 2010 Sebastian Trueg <trueg@kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "queryhistory.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+#include <QtCore/QStringList>
+#include <QtCore/QRegExp>
+#include <QtCore/QSet>
+#include <QtCore/QtAlgorithms>
+
+#include <KStandardDirs>
+#include <KSaveFile>
+#include <KDebug>
+
+
+namespace {
+/// Increase whenever the format of the log lines changes
+const int s_queryHistoryVersion = 1;
+
+/// The number of tab-separated fields of a run line
+const int s_fieldCount = 5;
+
+/// When the log is loaded only this many of the most recent runs of each query are kept
+const int s_maxRunsPerQuery = 20;
+
+/// When the log is loaded only this many of the most recently run queries are kept
+const int s_maxQueries = 2000;
+
+QString escape( const QString& s )
+{
+    QString result;
+    result.reserve( s.length() );
+    for( int i = 0; i < s.length(); ++i ) {
+        const QChar c = s[i];
+        if( c == QLatin1Char( '\\' ) )
+            result += QLatin1String( "\\\\" );
+        else if( c == QLatin1Char( '\t' ) )
+            result += QLatin1String( "\\t" );
+        else if( c == QLatin1Char( '\n' ) )
+            result += QLatin1String( "\\n" );
+        else if( c == QLatin1Char( '\r' ) )
+            result += QLatin1String( "\\r" );
+        else
+            result += c;
+    }
+    return result;
+}
+
+QString unescape( const QString& s )
+{
+    QString result;
+    result.reserve( s.length() );
+    for( int i = 0; i < s.length(); ++i ) {
+        const QChar c = s[i];
+        if( c == QLatin1Char( '\\' ) && i+1 < s.length() ) {
+            const QChar next = s[++i];
+            if( next == QLatin1Char( 't' ) )
+                result += QLatin1Char( '\t' );
+            else if( next == QLatin1Char( 'n' ) )
+                result += QLatin1Char( '\n' );
+            else if( next == QLatin1Char( 'r' ) )
+                result += QLatin1Char( '\r' );
+            else
+                result += next;
+        }
+        else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+QStringList words( const QString& text )
+{
+    return text.toLower().split( QRegExp( QLatin1String( "\\W+" ) ), QString::SkipEmptyParts );
+}
+
+class EntryLessThan
+{
+public:
+    EntryLessThan( const QVector<Nepomuk2::QueryHistoryEntry>& entries, Nepomuk2::QueryHistory::SortOrder order )
+        : m_entries( entries ),
+          m_order( order ) {
+    }
+
+    bool operator()( int i1, int i2 ) const {
+        if( m_order == Nepomuk2::QueryHistory::SlowestFirst )
+            return m_entries[i1].maxDuration() > m_entries[i2].maxDuration();
+        else
+            return m_entries[i1].lastRun().time > m_entries[i2].lastRun().time;
+    }
+
+private:
+    const QVector<Nepomuk2::QueryHistoryEntry>& m_entries;
+    Nepomuk2::QueryHistory::SortOrder m_order;
+};
+}
+
+
+int Nepomuk2::QueryHistoryEntry::maxDuration() const
+{
+    int duration = 0;
+    Q_FOREACH( const QueryRun& run, runs ) {
+        duration = qMax( duration, run.duration );
+    }
+    return duration;
+}
+
+
+Nepomuk2::QueryHistory::QueryHistory( const QString& fileName )
+    : m_fileName( fileName ),
+      m_loaded( false )
+{
+    if( m_fileName.isEmpty() )
+        m_fileName = KStandardDirs::locateLocal( "appdata", QLatin1String( "queryhistory" ) );
+}
+
+
+Nepomuk2::QueryHistory::~QueryHistory()
+{
+}
+
+
+bool Nepomuk2::QueryHistory::isLoaded() const
+{
+    return m_loaded;
+}
+
+
+void Nepomuk2::QueryHistory::load()
+{
+    m_entries.clear();
+    m_entryIndex.clear();
+    m_wordIndex.clear();
+    m_loaded = true;
+
+    QFile file( m_fileName );
+    if( !file.open( QIODevice::ReadOnly ) )
+        return;
+
+    QTextStream stream( &file );
+    stream.setCodec( "UTF-8" );
+    if( stream.readLine().toInt() != s_queryHistoryVersion ) {
+        // New runs must not be appended to a log we cannot read. It might have been
+        // written by a newer version, thus, we keep it aside instead of deleting it.
+        const QString backup = QString::fromLatin1( "%1.%2.bak" )
+                               .arg( m_fileName, QDateTime::currentDateTime().toString( QLatin1String( "yyyyMMddhhmmss" ) ) );
+        kDebug() << "Moving query history with unknown format to" << backup;
+        file.close();
+        if( !file.rename( backup ) )
+            kDebug() << "Failed to move" << m_fileName << file.errorString();
+        return;
+    }
+
+    // one "time<tab>duration<tab>rows<tab>error<tab>query" line per run
+    while( !stream.atEnd() ) {
+        const QStringList fields = stream.readLine().split( QLatin1Char( '\t' ) );
+        if( fields.count() != s_fieldCount )
+            continue;
+
+        QueryRun run;
+        run.time = QDateTime::fromString( fields[0], Qt::ISODate );
+        run.duration = fields[1].toInt();
+        run.rowCount = fields[2].toInt();
+        run.error = unescape( fields[3] );
+        const QString query = unescape( fields[4] );
+        if( !run.time.isValid() || query.isEmpty() )
+            continue;
+
+        m_entries[entryIndex( query )].runs << run;
+    }
+    file.close();
+
+    compact();
+}
+
+
+void Nepomuk2::QueryHistory::compact()
+{
+    // The log only grows. Once it holds more than we keep, only the recent runs
+    // of the recent queries are written back.
+    QList<int> indices;
+    bool tooManyRuns = false;
+    for( int i = 0; i < m_entries.count(); ++i ) {
+        indices << i;
+        if( m_entries[i].runs.count() > s_maxRunsPerQuery )
+            tooManyRuns = true;
+    }
+    if( !tooManyRuns && m_entries.count() <= s_maxQueries )
+        return;
+
+    qSort( indices.begin(), indices.end(), EntryLessThan( m_entries, MostRecentFirst ) );
+    QList<QueryHistoryEntry> entries;
+    Q_FOREACH( int index, indices.mid( 0, s_maxQueries ) ) {
+        QueryHistoryEntry entry = m_entries[index];
+        if( entry.runs.count() > s_maxRunsPerQuery )
+            entry.runs = entry.runs.mid( entry.runs.count() - s_maxRunsPerQuery );
+        entries << entry;
+    }
+
+    m_entries.clear();
+    m_entryIndex.clear();
+    m_wordIndex.clear();
+    Q_FOREACH( const QueryHistoryEntry& entry, entries ) {
+        m_entries[entryIndex( entry.query )].runs = entry.runs;
+    }
+
+    // written to a new file which replaces the log only once complete
+    KSaveFile file( m_fileName );
+    if( !file.open() ) {
+        kDebug() << "Failed to compact query history" << m_fileName << file.errorString();
+        return;
+    }
+    QTextStream stream( &file );
+    stream.setCodec( "UTF-8" );
+    stream << s_queryHistoryVersion << '\n';
+    Q_FOREACH( const QueryHistoryEntry& entry, m_entries ) {
+        Q_FOREACH( const QueryRun& run, entry.runs ) {
+            writeRun( stream, entry.query, run );
+        }
+    }
+    stream.flush();
+    if( !file.finalize() )
+        kDebug() << "Failed to compact query history" << m_fileName << file.errorString();
+}
+
+
+void Nepomuk2::QueryHistory::addRun( const QString& query, const QueryRun& run )
+{
+    // without load() the run is only appended, it is read with the rest of the log later on
+    if( m_loaded )
+        m_entries[entryIndex( query )].runs << run;
+
+    QFile file( m_fileName );
+    if( !file.open( QIODevice::ReadWrite ) ) {
+        kDebug() << "Failed to write query history" << m_fileName;
+        return;
+    }
+
+    // a line cut off by a crash must not swallow the new one
+    char lastChar = '\n';
+    if( file.size() > 0 && file.seek( file.size() - 1 ) )
+        file.getChar( &lastChar );
+    file.seek( file.size() );
+
+    QTextStream stream( &file );
+    stream.setCodec( "UTF-8" );
+    if( file.size() == 0 )
+        stream << s_queryHistoryVersion << '\n';
+    else if( lastChar != '\n' )
+        stream << '\n';
+    writeRun( stream, query, run );
+}
+
+
+void Nepomuk2::QueryHistory::writeRun( QTextStream& stream, const QString& query, const QueryRun& run )
+{
+    stream << run.time.toString( Qt::ISODate ) << '\t'
+           << run.duration << '\t'
+           << run.rowCount << '\t'
+           << escape( run.error ) << '\t'
+           << escape( query ) << '\n';
+}
+
+
+QList<Nepomuk2::QueryHistoryEntry> Nepomuk2::QueryHistory::search( const QString& text, SortOrder order ) const
+{
+    const QStringList searchWords = words( text );
+    if( searchWords.isEmpty() ) {
+        QList<int> indices;
+        for( int i = 0; i < m_entries.count(); ++i )
+            indices << i;
+        return sortedEntries( indices, order );
+    }
+
+    QSet<int> matches;
+    for( int i = 0; i < searchWords.count(); ++i ) {
+        // all indexed words starting with the search word are consecutive in the map
+        QSet<int> wordMatches;
+        const QString& word = searchWords[i];
+        for( QMap<QString, QVector<int> >::const_iterator it = m_wordIndex.lowerBound( word );
+             it != m_wordIndex.constEnd() && it.key().startsWith( word ); ++it ) {
+            Q_FOREACH( int index, it.value() ) {
+                wordMatches.insert( index );
+            }
+        }
+
+        if( i == 0 )
+            matches = wordMatches;
+        else
+            matches.intersect( wordMatches );
+        if( matches.isEmpty() )
+            break;
+    }
+
+    return sortedEntries( matches.toList(), order );
+}
+
+
+int Nepomuk2::QueryHistory::entryIndex( const QString& query )
+{
+    QHash<QString, int>::const_iterator it = m_entryIndex.constFind( query );
+    if( it != m_entryIndex.constEnd() )
+        return it.value();
+
+    const int index = m_entries.count();
+    QueryHistoryEntry entry;
+    entry.query = query;
+    m_entries << entry;
+    m_entryIndex.insert( query, index );
+
+    Q_FOREACH( const QString& word, words( query ).toSet() ) {
+        m_wordIndex[word] << index;
+    }
+
+    return index;
+}
+
+
+QList<Nepomuk2::QueryHistoryEntry> Nepomuk2::QueryHistory::sortedEntries( const QList<int>& indices, SortOrder order ) const
+{
+    QList<int> sortedIndices = indices;
+    qSort( sortedIndices.begin(), sortedIndices.end(), EntryLessThan( m_entries, order ) );
+
+    QList<QueryHistoryEntry> entries;
+    Q_FOREACH( int index, sortedIndices ) {
+        entries << m_entries[index];
+    }
+    return entries;
+}
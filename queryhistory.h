@@ -0,0 +1,141 @@
+/*
+   Copyright (c) 2010 Sebastian Trueg <trueg@kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _NEPOMUK_QUERY_HISTORY_H_
+#define _NEPOMUK_QUERY_HISTORY_H_
+
+#include <QtCore/QString>
+#include <QtCore/QList>
+#include <QtCore/QVector>
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QDateTime>
+
+class QTextStream;
+
+namespace Nepomuk2 {
+    /**
+     * One execution of a query.
+     */
+    class QueryRun
+    {
+    public:
+        QueryRun()
+            : duration( 0 ),
+              rowCount( 0 ) {
+        }
+
+        QDateTime time;
+
+        /// in msecs
+        int duration;
+        int rowCount;
+
+        /// empty if the query succeeded
+        QString error;
+    };
+
+    /**
+     * A query with all its recorded runs, oldest first.
+     */
+    class QueryHistoryEntry
+    {
+    public:
+        QString query;
+        QList<QueryRun> runs;
+
+        QueryRun lastRun() const { return runs.last(); }
+
+        /// The longest duration of all runs in msecs
+        int maxDuration() const;
+    };
+
+    /**
+     * \class QueryHistory queryhistory.h
+     *
+     * \brief All queries ever run in the shell with their durations, row counts and errors.
+     *
+     * The runs are stored in an append-only log, one line per run. Thus, recording
+     * a run never rewrites the file. On load the log is replayed into one entry per
+     * distinct query and a word index which makes searching thousands of queries cheap.
+     * The log is only read once it is needed, old runs are dropped at that point.
+     */
+    class QueryHistory
+    {
+    public:
+        /**
+         * Create a history backed by \p fileName. By default the log in the
+         * application data folder is used.
+         */
+        explicit QueryHistory( const QString& fileName = QString() );
+        ~QueryHistory();
+
+        /**
+         * Read the log. Lines cut off by a crash are skipped. A log in a different
+         * format version is moved aside. If the log holds more runs than are kept
+         * it is compacted.
+         */
+        void load();
+
+        /**
+         * \return \p true once load() has been called.
+         */
+        bool isLoaded() const;
+
+        /**
+         * Append \p run of \p query to the log. If the log has been loaded
+         * the run is recorded in memory, too.
+         */
+        void addRun( const QString& query, const QueryRun& run );
+
+        enum SortOrder {
+            /// the most recently run query first
+            MostRecentFirst,
+            /// the query with the longest run first
+            SlowestFirst
+        };
+
+        /**
+         * \return The entries which contain all words in \p text, each word
+         * matching the beginning of a word in the query. An empty \p text
+         * matches all entries.
+         */
+        QList<QueryHistoryEntry> search( const QString& text, SortOrder order = MostRecentFirst ) const;
+
+    private:
+        int entryIndex( const QString& query );
+        void compact();
+        static void writeRun( QTextStream& stream, const QString& query, const QueryRun& run );
+        QList<QueryHistoryEntry> sortedEntries( const QList<int>& indices, SortOrder order ) const;
+
+        QString m_fileName;
+        bool m_loaded;
+
+        QVector<QueryHistoryEntry> m_entries;
+
+        /// maps the query text to its position in m_entries
+        QHash<QString, int> m_entryIndex;
+
+        /// maps the lower-case words to the entries containing them, sorted for prefix lookup
+        QMap<QString, QVector<int> > m_wordIndex;
+    };
+}
+
+#endif
@@ -0,0 +1,167 @@
+/*
+   Copyright (c) 2010 Sebastian Trueg <trueg@kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "queryhistorydialog.h"
+#include "queryhistory.h"
+
+#include <QtGui/QTreeWidget>
+#include <QtGui/QHeaderView>
+#include <QtGui/QVBoxLayout>
+#include <QtGui/QHBoxLayout>
+
+#include <KLineEdit>
+#include <KComboBox>
+#include <KLocale>
+#include <KGlobal>
+
+
+namespace {
+    enum Columns {
+        QueryColumn = 0,
+        RunsColumn,
+        LastRunColumn,
+        RowsColumn,
+        DurationColumn,
+        SlowestColumn,
+        ErrorColumn
+    };
+
+    enum Views {
+        RecentView = 0,
+        SlowestView
+    };
+
+    /// The maximum number of queries listed at once
+    const int s_maxShownEntries = 500;
+}
+
+
+QueryHistoryDialog::QueryHistoryDialog( const Nepomuk2::QueryHistory* history, QWidget* parent )
+    : KDialog( parent ),
+      m_history( history )
+{
+    setCaption( i18n( "Query History" ) );
+    setButtons( Ok|Cancel );
+    setButtonText( Ok, i18n( "Load Query" ) );
+
+    QWidget* w = new QWidget( this );
+    QVBoxLayout* lay = new QVBoxLayout( w );
+    lay->setMargin( 0 );
+
+    QHBoxLayout* searchLay = new QHBoxLayout;
+    m_searchEdit = new KLineEdit( w );
+    m_searchEdit->setClearButtonShown( true );
+    m_searchEdit->setClickMessage( i18n( "Search queries" ) );
+    m_viewCombo = new KComboBox( w );
+    m_viewCombo->addItem( i18n( "Most Recent" ) );
+    m_viewCombo->addItem( i18n( "Slowest" ) );
+    searchLay->addWidget( m_searchEdit, 1 );
+    searchLay->addWidget( m_viewCombo );
+
+    m_entryView = new QTreeWidget( w );
+    m_entryView->setRootIsDecorated( false );
+    m_entryView->setAlternatingRowColors( true );
+    m_entryView->setHeaderLabels( QStringList()
+                                  << i18n( "Query" )
+                                  << i18n( "Runs" )
+                                  << i18n( "Last Run" )
+                                  << i18n( "Rows" )
+                                  << i18n( "Duration" )
+                                  << i18n( "Slowest" )
+                                  << i18n( "Error" ) );
+    m_entryView->header()->setStretchLastSection( false );
+    m_entryView->header()->setResizeMode( QHeaderView::ResizeToContents );
+    m_entryView->header()->setResizeMode( QueryColumn, QHeaderView::Stretch );
+
+    lay->addLayout( searchLay );
+    lay->addWidget( m_entryView );
+    setMainWidget( w );
+
+    connect( m_searchEdit, SIGNAL(textChanged(QString)),
+             this, SLOT(slotUpdateList()) );
+    connect( m_viewCombo, SIGNAL(currentIndexChanged(int)),
+             this, SLOT(slotUpdateList()) );
+    connect( m_entryView, SIGNAL(itemActivated(QTreeWidgetItem*, int)),
+             this, SLOT(slotItemActivated(QTreeWidgetItem*)) );
+
+    slotUpdateList();
+    m_searchEdit->setFocus();
+
+    resize( 800, 500 );
+}
+
+
+QueryHistoryDialog::~QueryHistoryDialog()
+{
+}
+
+
+QString QueryHistoryDialog::selectedQuery() const
+{
+    if( QTreeWidgetItem* item = m_entryView->currentItem() )
+        return item->data( QueryColumn, Qt::UserRole ).toString();
+    else
+        return QString();
+}
+
+
+void QueryHistoryDialog::slotUpdateList()
+{
+    const Nepomuk2::QueryHistory::SortOrder order = ( m_viewCombo->currentIndex() == SlowestView
+                                                      ? Nepomuk2::QueryHistory::SlowestFirst
+                                                      : Nepomuk2::QueryHistory::MostRecentFirst );
+    const QList<Nepomuk2::QueryHistoryEntry> entries = m_history->search( m_searchEdit->text(), order );
+
+    m_entryView->clear();
+    QList<QTreeWidgetItem*> items;
+    Q_FOREACH( const Nepomuk2::QueryHistoryEntry& entry, entries.mid( 0, s_maxShownEntries ) ) {
+        const Nepomuk2::QueryRun lastRun = entry.lastRun();
+        QTreeWidgetItem* item = new QTreeWidgetItem;
+        item->setText( QueryColumn, entry.query.simplified() );
+        item->setToolTip( QueryColumn, entry.query );
+        item->setData( QueryColumn, Qt::UserRole, entry.query );
+        item->setText( RunsColumn, QString::number( entry.runs.count() ) );
+        item->setText( LastRunColumn, KGlobal::locale()->formatDateTime( lastRun.time, KLocale::ShortDate, true ) );
+        item->setText( RowsColumn, QString::number( lastRun.rowCount ) );
+        item->setText( DurationColumn, KGlobal::locale()->formatDuration( lastRun.duration ) );
+        item->setText( SlowestColumn, KGlobal::locale()->formatDuration( entry.maxDuration() ) );
+        item->setText( ErrorColumn, lastRun.error );
+        item->setToolTip( ErrorColumn, lastRun.error );
+        for( int column = RunsColumn; column <= SlowestColumn; ++column ) {
+            if( column != LastRunColumn )
+                item->setTextAlignment( column, Qt::AlignRight|Qt::AlignVCenter );
+        }
+        items << item;
+    }
+    m_entryView->addTopLevelItems( items );
+    if( !items.isEmpty() )
+        m_entryView->setCurrentItem( items.first() );
+
+    enableButtonOk( !items.isEmpty() );
+}
+
+
+void QueryHistoryDialog::slotItemActivated( QTreeWidgetItem* item )
+{
+    m_entryView->setCurrentItem( item );
+    accept();
+}
+
+#include "queryhistorydialog.moc"
@@ -0,0 +1,64 @@
+/*
+   Copyright (c) 2010 Sebastian Trueg <trueg@kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _NEPOMUK_QUERY_HISTORY_DIALOG_H_
+#define _NEPOMUK_QUERY_HISTORY_DIALOG_H_
+
+#include <KDialog>
+
+class KLineEdit;
+class KComboBox;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+namespace Nepomuk2 {
+    class QueryHistory;
+}
+
+/**
+ * Lists the recorded queries with their run statistics. The list can
+ * be searched or sorted by the slowest run to spot regressions.
+ */
+class QueryHistoryDialog : public KDialog
+{
+    Q_OBJECT
+
+public:
+    QueryHistoryDialog( const Nepomuk2::QueryHistory* history, QWidget* parent = 0 );
+    ~QueryHistoryDialog();
+
+    /**
+     * \return The query the user picked or an empty string.
+     */
+    QString selectedQuery() const;
+
+private Q_SLOTS:
+    void slotUpdateList();
+    void slotItemActivated( QTreeWidgetItem* item );
+
+private:
+    const Nepomuk2::QueryHistory* m_history;
+
+    KLineEdit* m_searchEdit;
+    KComboBox* m_viewCombo;
+    QTreeWidget* m_entryView;
+};
+
+#endif
@@ -20,6 +20,7 @@
 */
 
 #include "querymodel.h"
+#include "prefixregistry.h"
 
 #include <QtCore/QTime>
 
@@ -30,22 +31,9 @@
 #include <Soprano/QueryResultIterator>
 #include <Soprano/Util/AsyncQuery>
 
-#define USING_SOPRANO_NRLMODEL_UNSTABLE_API
-#include <Soprano/NRLModel>
-
 #include <KDebug>
 
 
-namespace {
-void splitUri( const QUrl& uri, QUrl& ns, QString& name )
-{
-    const QString uriStr = uri.toString();
-    const int i = uriStr.lastIndexOf( QRegExp(QLatin1String("[/#]")) ) + 1;
-    ns = uriStr.left( i );
-    name = uriStr.mid( i );
-}
-}
-
 class Nepomuk2::QueryModel::Private
 {
 public:
@@ -60,8 +48,6 @@ public:
 
     Soprano::Util::AsyncQuery * m_currentQuery;
 
-    QHash<QUrl, QString> m_bnames;
-
     void updateQuery();
     QString resourceToString( const QUrl& uri ) const;
 };
@@ -94,12 +80,9 @@ void Nepomuk2::QueryModel::Private::updateQuery()
 
 QString Nepomuk2::QueryModel::Private::resourceToString(const QUrl &uri) const
 {
-    QUrl ns;
-    QString name;
-    splitUri( uri, ns, name );
-    QHash<QUrl, QString>::const_iterator it = m_bnames.constFind(ns);
-    if( it != m_bnames.constEnd() ) {
-        return QString::fromLatin1("%1:%2").arg( it.value(), name );
+    const QString curie = PrefixRegistry::self()->toCurie( uri );
+    if( !curie.isEmpty() ) {
+        return curie;
     }
     else {
         return uri.toString();
@@ -111,13 +94,6 @@ Nepomuk2::QueryModel::QueryModel( QObject* parent )
     : QAbstractTableModel( parent ),
       d(new Private( this ))
 {
-    Soprano::NRLModel nrlModel( ResourceManager::instance()->mainModel() );
-    nrlModel.setEnableQueryPrefixExpansion( true );
-    QHash<QString, QUrl> queryPrefixes = nrlModel.queryPrefixes();
-    for( QHash<QString, QUrl>::const_iterator it = queryPrefixes.constBegin();
-         it != queryPrefixes.constEnd(); ++it ) {
-        d->m_bnames.insert( it.value(), it.key() );
-    }
 }
 
 
@@ -0,0 +1,121 @@
+/*
+   Copyright (c) 2010 Sebastian Trueg <trueg@kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "queryplanbackend.h"
+
+#include <QtCore/QRegExp>
+
+
+namespace {
+    /// A number as printed by Virtuoso, for example "12", "0.5" or "3.2e+02"
+    const char* s_numberPattern = "(\\d+(?:\\.\\d+)?(?:e[+-]?\\d+)?)";
+}
+
+
+Nepomuk2::QueryPlanBackend::~QueryPlanBackend()
+{
+}
+
+
+QString Nepomuk2::QueryPlanBackend::commandUserLanguage() const
+{
+    return QString();
+}
+
+
+QString Nepomuk2::VirtuosoQueryPlanBackend::explainCommand( const QString& query ) const
+{
+    QString sparql = query;
+    sparql.replace( QLatin1String( "\\" ), QLatin1String( "\\\\" ) );
+    sparql.replace( QLatin1String( "'" ), QLatin1String( "''" ) );
+    return QString::fromLatin1( "explain('sparql %1')" ).arg( sparql );
+}
+
+
+Soprano::Query::QueryLanguage Nepomuk2::VirtuosoQueryPlanBackend::commandLanguage() const
+{
+    return Soprano::Query::QueryLanguageUser;
+}
+
+
+QString Nepomuk2::VirtuosoQueryPlanBackend::commandUserLanguage() const
+{
+    return QLatin1String( "sql" );
+}
+
+
+Nepomuk2::QueryPlanNode Nepomuk2::VirtuosoQueryPlanBackend::parsePlan( const QStringList& lines ) const
+{
+    QRegExp rowsRegExp( QLatin1String( s_numberPattern ) + QLatin1String( "\\s+rows?\\b" ), Qt::CaseInsensitive );
+    QRegExp costRegExp( QLatin1String( "\\b(?:cost|time)\\s*[:=]?\\s*" ) + QLatin1String( s_numberPattern ), Qt::CaseInsensitive );
+
+    // Blocks are enclosed in braces. A brace at the end of a line makes
+    // the operator on that line the parent of the block.
+    QueryPlanNode root;
+    QList<QueryPlanNode*> parents;
+    parents << &root;
+
+    Q_FOREACH( const QString& line, lines ) {
+        QString text = line.trimmed();
+        while( text.startsWith( QLatin1Char( '}' ) ) ) {
+            if( parents.count() > 1 )
+                parents.removeLast();
+            text = text.mid( 1 ).trimmed();
+        }
+        if( text.isEmpty() )
+            continue;
+
+        bool opensBlock = false;
+        if( text.startsWith( QLatin1Char( '{' ) ) ) {
+            opensBlock = true;
+            text = text.mid( 1 ).trimmed();
+        }
+        if( text.endsWith( QLatin1Char( '{' ) ) ) {
+            opensBlock = true;
+            text.chop( 1 );
+            text = text.trimmed();
+        }
+        bool closesBlock = false;
+        if( text.endsWith( QLatin1Char( '}' ) ) ) {
+            closesBlock = true;
+            text.chop( 1 );
+            text = text.trimmed();
+        }
+
+        QueryPlanNode node;
+        node.operatorName = text.section( QLatin1Char( ' ' ), 0, 0, QString::SectionSkipEmpty );
+        node.details = text.section( QLatin1Char( ' ' ), 1, -1, QString::SectionSkipEmpty );
+        if( node.operatorName.isEmpty() )
+            node.operatorName = QLatin1String( "{ }" );
+        if( rowsRegExp.indexIn( text ) >= 0 )
+            node.cardinality = rowsRegExp.cap( 1 ).toDouble();
+        if( costRegExp.indexIn( text ) >= 0 )
+            node.cost = costRegExp.cap( 1 ).toDouble();
+
+        QueryPlanNode* parent = parents.last();
+        parent->children << node;
+        if( opensBlock && !closesBlock )
+            parents << &parent->children.last();
+        else if( closesBlock && !opensBlock && parents.count() > 1 )
+            parents.removeLast();
+    }
+
+    return root;
+}
@@ -0,0 +1,97 @@
+/*
+   Copyright (c) 2010 Sebastian Trueg <trueg@kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _NEPOMUK_QUERY_PLAN_BACKEND_H_
+#define _NEPOMUK_QUERY_PLAN_BACKEND_H_
+
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include <Soprano/Query/QueryLanguage>
+
+namespace Nepomuk2 {
+
+    /**
+     * One operator of a query plan.
+     */
+    class QueryPlanNode
+    {
+    public:
+        QueryPlanNode()
+            : cardinality( -1.0 ),
+              cost( -1.0 ) {
+        }
+
+        QString operatorName;
+        QString details;
+
+        /// The estimated number of rows, -1 if unknown
+        double cardinality;
+
+        /// The estimated cost or, for profiles, the share of the time, -1 if unknown
+        double cost;
+
+        QList<QueryPlanNode> children;
+    };
+
+
+    /**
+     * Fetching and parsing the query plan is specific to the store backend.
+     *
+     * The plan is fetched by running explainCommand() on the model. Each
+     * result row yields one line of the plan, which parsePlan() turns into
+     * a tree. Thus, a backend can be tested against any Soprano::Model
+     * which returns a canned plan.
+     */
+    class QueryPlanBackend
+    {
+    public:
+        virtual ~QueryPlanBackend();
+
+        /**
+         * The command which returns the plan of the SPARQL \p query.
+         */
+        virtual QString explainCommand( const QString& query ) const = 0;
+        virtual Soprano::Query::QueryLanguage commandLanguage() const = 0;
+        virtual QString commandUserLanguage() const;
+
+        /**
+         * \return A root node which has the top-level operators as children.
+         */
+        virtual QueryPlanNode parsePlan( const QStringList& lines ) const = 0;
+    };
+
+
+    /**
+     * Uses Virtuoso's explain() through the "sql" user query language
+     * and parses the nesting of its text report.
+     */
+    class VirtuosoQueryPlanBackend : public QueryPlanBackend
+    {
+    public:
+        QString explainCommand( const QString& query ) const;
+        Soprano::Query::QueryLanguage commandLanguage() const;
+        QString commandUserLanguage() const;
+        QueryPlanNode parsePlan( const QStringList& lines ) const;
+    };
+}
+
+#endif
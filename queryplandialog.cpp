@@ -0,0 +1,166 @@
+/*
+   Copyright (c) 2010 Sebastian Trueg <trueg@kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "queryplandialog.h"
+#include "queryplanbackend.h"
+
+#include <QtGui/QLabel>
+#include <QtGui/QTreeWidget>
+#include <QtGui/QHeaderView>
+#include <QtGui/QVBoxLayout>
+
+#include <KLocale>
+#include <KGlobal>
+#include <KDebug>
+
+#include <Soprano/Model>
+#include <Soprano/Node>
+#include <Soprano/Util/AsyncQuery>
+
+
+namespace {
+    enum Columns {
+        OperatorColumn = 0,
+        CardinalityColumn,
+        CostColumn,
+        DetailsColumn
+    };
+}
+
+
+QueryPlanDialog::QueryPlanDialog( Nepomuk2::QueryPlanBackend* backend, Soprano::Model* model, QWidget* parent )
+    : KDialog( parent ),
+      m_backend( backend ),
+      m_model( model ),
+      m_planQuery( 0 )
+{
+    setCaption( i18n( "Query Plan" ) );
+    setButtons( Close );
+
+    QWidget* w = new QWidget( this );
+    QVBoxLayout* lay = new QVBoxLayout( w );
+    lay->setMargin( 0 );
+
+    m_planView = new QTreeWidget( w );
+    m_planView->setHeaderLabels( QStringList()
+                                 << i18n( "Operator" )
+                                 << i18n( "Rows" )
+                                 << i18n( "Cost" )
+                                 << i18n( "Details" ) );
+    m_planView->setAlternatingRowColors( true );
+    m_planView->header()->setResizeMode( QHeaderView::ResizeToContents );
+
+    m_statusLabel = new QLabel( w );
+    m_statusLabel->setWordWrap( true );
+
+    lay->addWidget( m_planView );
+    lay->addWidget( m_statusLabel );
+    setMainWidget( w );
+
+    resize( 700, 500 );
+}
+
+
+QueryPlanDialog::~QueryPlanDialog()
+{
+    if( m_planQuery )
+        m_planQuery->close();
+    delete m_backend;
+}
+
+
+void QueryPlanDialog::explain( const QString& query )
+{
+    if( m_planQuery ) {
+        m_planQuery->disconnect( this );
+        m_planQuery->close();
+    }
+
+    m_planLines.clear();
+    m_planView->clear();
+    m_statusLabel->setText( i18n( "Fetching the query plan..." ) );
+
+    m_planQuery = Soprano::Util::AsyncQuery::executeQuery( m_model,
+                                                           m_backend->explainCommand( query ),
+                                                           m_backend->commandLanguage(),
+                                                           m_backend->commandUserLanguage() );
+    connect( m_planQuery, SIGNAL(nextReady(Soprano::Util::AsyncQuery*)),
+             this, SLOT(slotPlanLineReady(Soprano::Util::AsyncQuery*)) );
+    connect( m_planQuery, SIGNAL(finished(Soprano::Util::AsyncQuery*)),
+             this, SLOT(slotPlanQueryFinished(Soprano::Util::AsyncQuery*)) );
+}
+
+
+void QueryPlanDialog::slotPlanLineReady( Soprano::Util::AsyncQuery* query )
+{
+    QStringList values;
+    for( int i = 0; i < query->bindingCount(); ++i )
+        values << query->binding( i ).toString();
+
+    // some stores return the whole report in one row
+    m_planLines << values.join( QLatin1String( " " ) ).split( QLatin1Char( '\n' ) );
+    query->next();
+}
+
+
+void QueryPlanDialog::slotPlanQueryFinished( Soprano::Util::AsyncQuery* query )
+{
+    m_planQuery = 0;
+
+    if( query->lastError() ) {
+        kDebug() << query->lastError();
+        m_statusLabel->setText( i18n( "The store could not explain the query: %1", query->lastError().message() ) );
+        return;
+    }
+
+    const Nepomuk2::QueryPlanNode root = m_backend->parsePlan( m_planLines );
+    Q_FOREACH( const Nepomuk2::QueryPlanNode& node, root.children ) {
+        addPlanItems( 0, node );
+    }
+    m_planView->expandAll();
+
+    if( root.children.isEmpty() )
+        m_statusLabel->setText( i18n( "The store returned an empty query plan." ) );
+    else
+        m_statusLabel->setText( i18np( "1 operator", "%1 operators", m_planView->topLevelItemCount() ) );
+}
+
+
+void QueryPlanDialog::addPlanItems( QTreeWidgetItem* parent, const Nepomuk2::QueryPlanNode& node )
+{
+    QTreeWidgetItem* item = parent ? new QTreeWidgetItem( parent ) : new QTreeWidgetItem( m_planView );
+    item->setText( OperatorColumn, node.operatorName );
+    item->setText( DetailsColumn, node.details );
+    item->setToolTip( DetailsColumn, node.details );
+    if( node.cardinality >= 0 ) {
+        item->setText( CardinalityColumn, KGlobal::locale()->formatNumber( node.cardinality, 0 ) );
+        item->setTextAlignment( CardinalityColumn, Qt::AlignRight|Qt::AlignVCenter );
+    }
+    if( node.cost >= 0 ) {
+        item->setText( CostColumn, KGlobal::locale()->formatNumber( node.cost ) );
+        item->setTextAlignment( CostColumn, Qt::AlignRight|Qt::AlignVCenter );
+    }
+
+    Q_FOREACH( const Nepomuk2::QueryPlanNode& child, node.children ) {
+        addPlanItems( item, child );
+    }
+}
+
+#include "queryplandialog.moc"
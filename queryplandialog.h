@@ -0,0 +1,77 @@
+/*
+   Copyright (c) 2010 Sebastian Trueg <trueg@kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _NEPOMUK_QUERY_PLAN_DIALOG_H_
+#define _NEPOMUK_QUERY_PLAN_DIALOG_H_
+
+#include <KDialog>
+
+#include <QtCore/QStringList>
+
+class QLabel;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+namespace Soprano {
+    class Model;
+    namespace Util {
+        class AsyncQuery;
+    }
+}
+namespace Nepomuk2 {
+    class QueryPlanBackend;
+    class QueryPlanNode;
+}
+
+/**
+ * Shows the plan of a query as a tree of operators with their
+ * estimated cardinalities and costs.
+ */
+class QueryPlanDialog : public KDialog
+{
+    Q_OBJECT
+
+public:
+    /**
+     * The dialog takes ownership of \p backend.
+     */
+    QueryPlanDialog( Nepomuk2::QueryPlanBackend* backend, Soprano::Model* model, QWidget* parent = 0 );
+    ~QueryPlanDialog();
+
+    void explain( const QString& query );
+
+private Q_SLOTS:
+    void slotPlanLineReady( Soprano::Util::AsyncQuery* query );
+    void slotPlanQueryFinished( Soprano::Util::AsyncQuery* query );
+
+private:
+    void addPlanItems( QTreeWidgetItem* parent, const Nepomuk2::QueryPlanNode& node );
+
+    Nepomuk2::QueryPlanBackend* m_backend;
+    Soprano::Model* m_model;
+
+    Soprano::Util::AsyncQuery* m_planQuery;
+    QStringList m_planLines;
+
+    QTreeWidget* m_planView;
+    QLabel* m_statusLabel;
+};
+
+#endif
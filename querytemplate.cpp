@@ -0,0 +1,217 @@
+/*
+   Copyright (c) 2010 Sebastian Trueg <trueg@kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "querytemplate.h"
+#include "sparqltokenizer.h"
+
+#include <QtCore/QRegExp>
+
+
+Nepomuk2::QueryTemplate::QueryTemplate()
+    : m_patternStart( -1 ),
+      m_patternEnd( -1 )
+{
+}
+
+
+Nepomuk2::QueryTemplate::QueryTemplate( const QString& query )
+    : m_query( query ),
+      m_patternStart( -1 ),
+      m_patternEnd( -1 )
+{
+    SparqlTokenizer tokenizer( query );
+    SparqlTokenizer::Token token;
+    int depth = 0;
+    bool construct = false;
+    bool where = false;
+    bool projection = false;
+    bool afterAs = false;
+    while( ( token = tokenizer.next() ).type != SparqlTokenizer::End ) {
+        const QString text = tokenizer.text( token );
+        if( token.type == SparqlTokenizer::Variable ) {
+            const QString name = text.mid( 1 );
+            if( text[0] == QLatin1Char( '$' ) ) {
+                if( !m_parameters.contains( name ) )
+                    m_parameters << name;
+
+                // Only variables in the graph pattern can be replaced with a value. A selected
+                // or bound variable has to stay a variable.
+                if( m_patternStart >= 0 && m_patternEnd < 0 && !projection && !afterAs ) {
+                    m_slotStarts << token.start;
+                    m_slotNames << name;
+                }
+                else {
+                    m_fixedParameters.insert( name );
+                }
+            }
+        }
+        else if( token.type == SparqlTokenizer::Keyword ) {
+            if( text.compare( QLatin1String( "select" ), Qt::CaseInsensitive ) == 0 )
+                projection = true;
+            else if( depth == 0 && text.compare( QLatin1String( "construct" ), Qt::CaseInsensitive ) == 0 )
+                construct = true;
+            else if( depth == 0 && text.compare( QLatin1String( "where" ), Qt::CaseInsensitive ) == 0 )
+                where = true;
+        }
+        else if( text == QLatin1String( "{" ) ) {
+            // the first bracket of a CONSTRUCT query opens the template
+            if( depth == 0 && m_patternStart < 0 && ( where || !construct ) )
+                m_patternStart = token.start + token.length;
+            projection = false;
+            ++depth;
+        }
+        else if( text == QLatin1String( "}" ) ) {
+            depth = qMax( 0, depth-1 );
+            if( depth == 0 && m_patternStart >= 0 && m_patternEnd < 0 )
+                m_patternEnd = token.start;
+        }
+
+        if( token.type != SparqlTokenizer::Comment )
+            afterAs = ( token.type == SparqlTokenizer::Keyword &&
+                        text.compare( QLatin1String( "as" ), Qt::CaseInsensitive ) == 0 );
+    }
+}
+
+
+QString Nepomuk2::QueryTemplate::query() const
+{
+    return m_query;
+}
+
+
+QStringList Nepomuk2::QueryTemplate::parameters() const
+{
+    return m_parameters;
+}
+
+
+QString Nepomuk2::QueryTemplate::bind( const QList<QHash<QString, QString> >& bindingSets ) const
+{
+    if( m_patternStart < 0 )
+        return m_query;
+
+    // convert each value only once and leave out the parameters without any value
+    QStringList names;
+    QList<QHash<QString, QString> > terms;
+    for( int i = 0; i < bindingSets.count(); ++i )
+        terms << QHash<QString, QString>();
+    bool substitute = ( m_patternEnd >= 0 );
+    Q_FOREACH( const QString& name, m_parameters ) {
+        bool bound = false;
+        for( int i = 0; i < bindingSets.count(); ++i ) {
+            const QString term = valueToN3( bindingSets[i].value( name ) );
+            if( !term.isEmpty() ) {
+                terms[i].insert( name, term );
+                bound = true;
+            }
+        }
+        if( bound ) {
+            names << name;
+            substitute = substitute && !m_fixedParameters.contains( name );
+        }
+    }
+    if( names.isEmpty() )
+        return m_query;
+
+    if( substitute )
+        return substituteValues( terms );
+    else
+        return prependValues( names, terms );
+}
+
+
+QString Nepomuk2::QueryTemplate::substituteValues( const QList<QHash<QString, QString> >& terms ) const
+{
+    // Virtuoso 6 does not know VALUES. Thus, the values are written into the pattern
+    // and the patterns of several binding sets are combined with UNION.
+    QStringList patterns;
+    Q_FOREACH( const QHash<QString, QString>& values, terms ) {
+        QString pattern;
+        int pos = m_patternStart;
+        for( int i = 0; i < m_slotNames.count(); ++i ) {
+            const QString& name = m_slotNames[i];
+            pattern += m_query.mid( pos, m_slotStarts[i] - pos );
+            pattern += values.value( name, QLatin1Char( '$' ) + name );
+            pos = m_slotStarts[i] + name.length() + 1;
+        }
+        pattern += m_query.mid( pos, m_patternEnd - pos );
+        patterns << pattern;
+    }
+
+    QString result = m_query.left( m_patternStart );
+    if( patterns.count() == 1 )
+        result += patterns.first();
+    else
+        result += QLatin1String( " {" ) + patterns.join( QLatin1String( "} UNION {" ) ) + QLatin1String( "} " );
+    return result + m_query.mid( m_patternEnd );
+}
+
+
+QString Nepomuk2::QueryTemplate::prependValues( const QStringList& names, const QList<QHash<QString, QString> >& terms ) const
+{
+    QString values = QLatin1String( " VALUES (" );
+    Q_FOREACH( const QString& name, names ) {
+        values += QLatin1Char( '$' ) + name + QLatin1Char( ' ' );
+    }
+    values += QLatin1String( ") {" );
+    Q_FOREACH( const QHash<QString, QString>& row, terms ) {
+        values += QLatin1String( " (" );
+        Q_FOREACH( const QString& name, names ) {
+            values += row.value( name, QLatin1String( "UNDEF" ) ) + QLatin1Char( ' ' );
+        }
+        values += QLatin1Char( ')' );
+    }
+    values += QLatin1String( " } " );
+
+    return m_query.left( m_patternStart ) + values + m_query.mid( m_patternStart );
+}
+
+
+QString Nepomuk2::QueryTemplate::valueToN3( const QString& value )
+{
+    const QString s = value.trimmed();
+    if( s.isEmpty() )
+        return QString();
+
+    if( s.startsWith( QLatin1Char( '<' ) ) ||
+        s.startsWith( QLatin1Char( '"' ) ) ||
+        s.startsWith( QLatin1Char( '\'' ) ) ||
+        s.startsWith( QLatin1String( "_:" ) ) ||
+        s == QLatin1String( "true" ) ||
+        s == QLatin1String( "false" ) )
+        return s;
+
+    // integers, decimals, and doubles as written in SPARQL, toDouble() also accepts "inf" or "1."
+    if( QRegExp( QLatin1String( "[+-]?(\\d+|\\d*\\.\\d+|(\\d+\\.?\\d*|\\.\\d+)[eE][+-]?\\d+)" ) ).exactMatch( s ) )
+        return s;
+
+    // "nepomuk:/res/..." or "http://..."
+    if( QRegExp( QLatin1String( "[a-zA-Z][a-zA-Z0-9+.-]*:/\\S*" ) ).exactMatch( s ) )
+        return QLatin1Char( '<' ) + s + QLatin1Char( '>' );
+
+    if( QRegExp( QLatin1String( "[a-zA-Z][\\w.-]*:[\\w.-]*" ) ).exactMatch( s ) )
+        return s;
+
+    QString literal = s;
+    literal.replace( QLatin1String( "\\" ), QLatin1String( "\\\\" ) );
+    literal.replace( QLatin1String( "\"" ), QLatin1String( "\\\"" ) );
+    literal.replace( QLatin1String( "\n" ), QLatin1String( "\\n" ) );
+    return QLatin1Char( '"' ) + literal + QLatin1Char( '"' );
+}
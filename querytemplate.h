@@ -0,0 +1,94 @@
+/*
+   Copyright (c) 2010 Sebastian Trueg <trueg@kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _NEPOMUK_QUERY_TEMPLATE_H_
+#define _NEPOMUK_QUERY_TEMPLATE_H_
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QSet>
+
+namespace Nepomuk2 {
+    /**
+     * \class QueryTemplate querytemplate.h
+     *
+     * \brief A query with named parameters written as "$name" variables.
+     *
+     * The query is tokenized once to find its parameters and its graph pattern.
+     * Parameters which only occur in the pattern are replaced with their values,
+     * several binding sets become a UNION of the pattern. A parameter which is
+     * selected or bound has to stay a variable. Then the values are passed in a
+     * SPARQL 1.1 VALUES block in front of the pattern instead. Either way all
+     * binding sets are run in one query.
+     */
+    class QueryTemplate
+    {
+    public:
+        QueryTemplate();
+        explicit QueryTemplate( const QString& query );
+
+        QString query() const;
+
+        /**
+         * \return The parameter names without the "$", in the order
+         * of their first occurrence.
+         */
+        QStringList parameters() const;
+
+        /**
+         * Bind the parameters to \p bindingSets, each of which maps parameter
+         * names to values. Each value is converted with valueToN3(). An empty
+         * value is UNDEF, a parameter without any value stays unbound.
+         */
+        QString bind( const QList<QHash<QString, QString> >& bindingSets ) const;
+
+        /**
+         * Convert a value as entered by the user into a SPARQL term.
+         * Terms in N3 syntax, numbers, booleans and prefixed names are
+         * used as is, absolute URIs get angle brackets and everything
+         * else becomes a string literal.
+         */
+        static QString valueToN3( const QString& value );
+
+    private:
+        QString substituteValues( const QList<QHash<QString, QString> >& terms ) const;
+        QString prependValues( const QStringList& names, const QList<QHash<QString, QString> >& terms ) const;
+
+        QString m_query;
+        QStringList m_parameters;
+
+        /// the position right after the opening bracket of the graph pattern, -1 if there is none
+        int m_patternStart;
+
+        /// the position of the closing bracket of the graph pattern, -1 if there is none
+        int m_patternEnd;
+
+        /// the positions of the parameters in the pattern which can be replaced with a value
+        QList<int> m_slotStarts;
+        QStringList m_slotNames;
+
+        /// the parameters which also occur outside of the pattern or as the target of AS
+        QSet<QString> m_fixedParameters;
+    };
+}
+
+#endif
@@ -36,6 +36,7 @@
 #include <QtGui/QComboBox>
 #include <QtGui/QItemSelectionModel>
 #include <QtGui/QSortFilterProxyModel>
+#include <QtCore/QTimer>
 
 #include <nepomuk2/class.h>
 #include <nepomuk2/property.h>
@@ -57,6 +58,11 @@
 Q_DECLARE_METATYPE( Nepomuk2::Resource )
 Q_DECLARE_METATYPE( Nepomuk2::Types::Class )
 
+namespace {
+/// The time in ms a class needs to stay selected before its resources are queried
+const int s_classQueryDelay = 250;
+}
+
 
 ResourceBrowserWidget::ResourceBrowserWidget( QWidget* parent )
     : QWidget( parent )
@@ -82,6 +88,12 @@ ResourceBrowserWidget::ResourceBrowserWidget( QWidget* parent )
 
     m_classFilter->setProxy( m_pimoSortModel );
 
+    m_queryTimer = new QTimer( this );
+    m_queryTimer->setSingleShot( true );
+    m_queryTimer->setInterval( s_classQueryDelay );
+    connect( m_queryTimer, SIGNAL(timeout()),
+             this, SLOT(slotUpdateResourceQuery()) );
+
     m_baseClassCombo->addItem( i18nc( "@item:inlistbox Referring to all RDF classes in the Nepomuk PIMO ontology", "PIMO Classes" ), QVariant( Nepomuk2::Vocabulary::PIMO::Thing() ) );
     m_baseClassCombo->addItem( i18nc( "@item:inlistbox Referring to all RDF classes in the Nepomuk db", "All Classes" ), QVariant( Soprano::Vocabulary::RDFS::Resource() ) );
 
@@ -97,6 +109,10 @@ ResourceBrowserWidget::ResourceBrowserWidget( QWidget* parent )
              this, SIGNAL(resourceActivated(Nepomuk2::Resource)) );
     connect( m_resourceView, SIGNAL(resourceTypeActivated(Nepomuk2::Types::Class)),
              this, SLOT(setSelectedClass(Nepomuk2::Types::Class)) );
+    connect( Settings::self(), SIGNAL(configChanged()),
+             this, SLOT(slotSettingsChanged()) );
+
+    slotSettingsChanged();
 }
 
 
@@ -134,6 +150,37 @@ void ResourceBrowserWidget::slotCurrentPIMOClassChanged( const QModelIndex& curr
 void ResourceBrowserWidget::slotBaseClassChanged( int index )
 {
     m_pimoModel->setRootClass( m_baseClassCombo->itemData( index ).toUrl() );
+    updateClassViewHeader();
+}
+
+
+void ResourceBrowserWidget::updateClassViewHeader()
+{
+    // the header sections are reset with the model, thus, we need to re-apply this after each reset
+    if( m_pimoModel->instanceCountMode() != Nepomuk2::Utils::ClassModel::NoInstanceCount ) {
+        m_pimoView->header()->setStretchLastSection( false );
+        m_pimoView->header()->setResizeMode( Nepomuk2::Utils::ClassModel::TypeColumn, QHeaderView::Stretch );
+        m_pimoView->header()->setResizeMode( Nepomuk2::Utils::ClassModel::InstanceCountColumn, QHeaderView::ResizeToContents );
+    }
+    else {
+        m_pimoView->header()->setStretchLastSection( true );
+    }
+}
+
+
+void ResourceBrowserWidget::slotSettingsChanged()
+{
+    // the counts follow the query mode so they match the listed resources
+    if( !Settings::self()->showInstanceCounts() ) {
+        m_pimoModel->setInstanceCountMode( Nepomuk2::Utils::ClassModel::NoInstanceCount );
+    }
+    else if( Settings::self()->recursiveQuery() ) {
+        m_pimoModel->setInstanceCountMode( Nepomuk2::Utils::ClassModel::InferredInstanceCount );
+    }
+    else {
+        m_pimoModel->setInstanceCountMode( Nepomuk2::Utils::ClassModel::DirectInstanceCount );
+    }
+    updateClassViewHeader();
 }
 
 
@@ -168,6 +215,12 @@ void ResourceBrowserWidget::createResource()
 }
 
 
+void ResourceBrowserWidget::removeResources( const QList<QUrl>& uris )
+{
+    m_resourceView->removeResources( uris );
+}
+
+
 QList<Nepomuk2::Resource> ResourceBrowserWidget::selectedResources() const
 {
     return m_resourceView->selectedResources();
@@ -203,6 +256,16 @@ void ResourceBrowserWidget::setSelectedClass( const Nepomuk2::Types::Class& type
     kDebug() << index << index.data(Nepomuk2::Utils::ClassModel::TypeRole).value<Nepomuk2::Types::Class>();
     m_pimoView->selectionModel()->setCurrentIndex(index, QItemSelectionModel::Clear|QItemSelectionModel::SelectCurrent);
 
+    // Stop listing the previous class right away but only start the new query once
+    // the selection settled. Otherwise holding down a cursor key results in one
+    // query per class passed.
+    m_resourceView->cancelQuery();
+    m_queryTimer->start();
+}
+
+
+void ResourceBrowserWidget::slotUpdateResourceQuery()
+{
     if( Settings::self()->recursiveQuery() ) {
         m_resourceView->setQuery( Nepomuk2::Query::Query( Nepomuk2::Query::ResourceTypeTerm( selectedClass() ) ) );
     }
@@ -29,6 +29,7 @@
 #include "ui_resourcebrowserwidget.h"
 
 class QSortFilterProxyModel;
+class QTimer;
 namespace Nepomuk2 {
     namespace Utils {
         class ClassModel;
@@ -55,17 +56,24 @@ public Q_SLOTS:
     void createClass();
     void createProperty();
     void createResource();
+    void removeResources( const QList<QUrl>& uris );
 
 private Q_SLOTS:
     void slotPIMOViewContextMenu( const QPoint& pos );
     void slotCurrentPIMOClassChanged( const QModelIndex& current, const QModelIndex& );
     void slotBaseClassChanged( int index );
+    void slotUpdateResourceQuery();
+    void slotSettingsChanged();
 
 private:
     void updateQuery( int offset );
+    void updateClassViewHeader();
 
     Nepomuk2::Utils::ClassModel* m_pimoModel;
     QSortFilterProxyModel* m_pimoSortModel;
+
+    /// delays the resource query while the user moves through the class tree
+    QTimer* m_queryTimer;
 };
 
 #endif
@@ -0,0 +1,106 @@
+/*
+   Copyright (C) 2010 by Sebastian Trueg <trueg at kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resourcedeletejob.h"
+
+#include <Nepomuk2/DataManagement>
+
+#include <KLocale>
+#include <KDebug>
+
+#include <QtCore/QTimer>
+
+
+namespace {
+/// The number of resources removed with one store call
+const int s_batchSize = 200;
+}
+
+
+Nepomuk2::ResourceDeleteJob::ResourceDeleteJob( const QList<QUrl>& resources, QObject* parent )
+    : KJob( parent ),
+      m_resources( resources ),
+      m_removedCount( 0 ),
+      m_currentJob( 0 )
+{
+    setCapabilities( Killable );
+}
+
+
+Nepomuk2::ResourceDeleteJob::~ResourceDeleteJob()
+{
+}
+
+
+void Nepomuk2::ResourceDeleteJob::start()
+{
+    emit description( this, i18nc( "@title job description", "Deleting Resources" ) );
+    setTotalAmount( KJob::Files, m_resources.count() );
+    QTimer::singleShot( 0, this, SLOT(slotRemoveNextBatch()) );
+}
+
+
+void Nepomuk2::ResourceDeleteJob::slotRemoveNextBatch()
+{
+    if( m_removedCount >= m_resources.count() ) {
+        emitResult();
+        return;
+    }
+
+    // same flags as Resource::remove() uses
+    m_currentBatch = m_resources.mid( m_removedCount, s_batchSize );
+    m_currentJob = Nepomuk2::removeResources( m_currentBatch, Nepomuk2::RemoveSubResoures );
+    connect( m_currentJob, SIGNAL(result(KJob*)),
+             this, SLOT(slotBatchFinished(KJob*)) );
+}
+
+
+void Nepomuk2::ResourceDeleteJob::slotBatchFinished( KJob* job )
+{
+    m_currentJob = 0;
+
+    if( job->error() ) {
+        kDebug() << job->errorString();
+        setError( job->error() );
+        setErrorText( job->errorText() );
+        emitResult();
+        return;
+    }
+
+    m_removedCount += m_currentBatch.count();
+    setProcessedAmount( KJob::Files, m_removedCount );
+    emitPercent( m_removedCount, m_resources.count() );
+    emit resourcesRemoved( m_currentBatch );
+
+    slotRemoveNextBatch();
+}
+
+
+bool Nepomuk2::ResourceDeleteJob::doKill()
+{
+    // the running batch will still be removed by the service, we simply do not wait for it
+    if( m_currentJob ) {
+        m_currentJob->disconnect( this );
+        m_currentJob = 0;
+    }
+    return true;
+}
+
+#include "resourcedeletejob.moc"
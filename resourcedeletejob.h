@@ -0,0 +1,74 @@
+/*
+   Copyright (C) 2010 by Sebastian Trueg <trueg at kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _NEPOMUK_RESOURCE_DELETE_JOB_H_
+#define _NEPOMUK_RESOURCE_DELETE_JOB_H_
+
+#include <KJob>
+
+#include <QtCore/QList>
+#include <QtCore/QUrl>
+
+namespace Nepomuk2 {
+    /**
+     * \class ResourceDeleteJob resourcedeletejob.h
+     *
+     * \brief Deletes a large number of resources in batches.
+     *
+     * The resources are removed through the data management service with one
+     * call per batch instead of one per resource. The actual removal happens in
+     * the storage service, the GUI only waits for the batches to finish.
+     *
+     * Progress is reported through the standard KJob signals and the job can
+     * be killed between two batches. A batch which is already being removed
+     * cannot be stopped anymore though.
+     */
+    class ResourceDeleteJob : public KJob
+    {
+        Q_OBJECT
+
+    public:
+        ResourceDeleteJob( const QList<QUrl>& resources, QObject* parent = 0 );
+        ~ResourceDeleteJob();
+
+        void start();
+
+    Q_SIGNALS:
+        /**
+         * Emitted once a batch of resources has been removed.
+         */
+        void resourcesRemoved( const QList<QUrl>& resources );
+
+    protected:
+        bool doKill();
+
+    private Q_SLOTS:
+        void slotRemoveNextBatch();
+        void slotBatchFinished( KJob* job );
+
+    private:
+        QList<QUrl> m_resources;
+        QList<QUrl> m_currentBatch;
+        int m_removedCount;
+        KJob* m_currentJob;
+    };
+}
+
+#endif
@@ -19,19 +19,35 @@
 */
 
 #include "resourceeditorwidget.h"
-#include "resourcepropertymodel.h"
 
 #include <QtGui/QTableView>
 #include <QtGui/QMenu>
 
+#include <Nepomuk2/ResourceWatcher>
+
 #include <KUrl>
 #include <KDebug>
 #include <KAction>
 #include <KIcon>
+#include <KMessageBox>
+
+
+namespace {
+/// The maximum number of statements kept in the snapshot cache
+const int s_snapshotCacheSize = 20000;
+
+/// The maximum number of resources in the snapshot cache, each of them is watched for changes
+const int s_maxSnapshots = 100;
+
+/// Backlinks are statements of other resources which we cannot watch. Thus, we only trust them for a while.
+const int s_backlinkSnapshotMaxAge = 60;
+}
 
 
 ResourceEditorWidget::ResourceEditorWidget( QWidget* parent )
-    : QWidget( parent )
+    : QWidget( parent ),
+      m_snapshotCost( 0 ),
+      m_watcherStarted( false )
 {
     setupUi( this );
 
@@ -41,11 +57,15 @@ ResourceEditorWidget::ResourceEditorWidget( QWidget* parent )
     m_propertyModel = new Nepomuk2::ResourcePropertyEditModel( m_propertyView );
     m_propertyView->setModel( m_propertyModel );
     m_propertyView->setContextMenuPolicy( Qt::CustomContextMenu );
+    m_propertyView->setSelectionBehavior( QAbstractItemView::SelectRows );
+    m_propertyView->setSelectionMode( QAbstractItemView::ExtendedSelection );
 
     m_backlinksModel = new Nepomuk2::ResourcePropertyEditModel( m_backlinksView );
     m_backlinksModel->setMode( Nepomuk2::ResourcePropertyEditModel::BacklinksMode );
     m_backlinksView->setModel( m_backlinksModel );
     m_backlinksView->setContextMenuPolicy( Qt::CustomContextMenu );
+    m_backlinksView->setSelectionBehavior( QAbstractItemView::SelectRows );
+    m_backlinksView->setSelectionMode( QAbstractItemView::ExtendedSelection );
 
     connect( m_propertyView, SIGNAL(customContextMenuRequested(QPoint)),
              this, SLOT(slotPropertyContextMenu(QPoint)) );
@@ -59,6 +79,21 @@ ResourceEditorWidget::ResourceEditorWidget( QWidget* parent )
             this, SLOT(slotResourceHistoryBack()) );
     connect(m_buttonForward, SIGNAL(clicked()),
             this, SLOT(slotResourceHistoryForward()) );
+    connect( m_propertyModel, SIGNAL(fullValueLoaded(QModelIndex)),
+             this, SLOT(slotFullValueLoaded(QModelIndex)) );
+    connect( m_propertyModel, SIGNAL(totalCountChanged(int)),
+             this, SLOT(slotPropertyCountChanged(int)) );
+    connect( m_backlinksModel, SIGNAL(totalCountChanged(int)),
+             this, SLOT(slotBacklinkCountChanged(int)) );
+
+    // one watcher for the shown resource and all cached ones, the models do not watch themselves
+    m_watcher = new Nepomuk2::ResourceWatcher( this );
+    connect( m_watcher, SIGNAL(propertyAdded(Nepomuk2::Resource,Nepomuk2::Types::Property,QVariant)),
+             this, SLOT(slotWatchedResourceChanged(Nepomuk2::Resource,Nepomuk2::Types::Property)) );
+    connect( m_watcher, SIGNAL(propertyRemoved(Nepomuk2::Resource,Nepomuk2::Types::Property,QVariant)),
+             this, SLOT(slotWatchedResourceChanged(Nepomuk2::Resource,Nepomuk2::Types::Property)) );
+    connect( m_watcher, SIGNAL(resourceRemoved(QUrl,QList<QUrl>)),
+             this, SLOT(slotWatchedResourceRemoved(QUrl)) );
 
     updateResourceHistoryButtonStates();
 }
@@ -85,17 +120,27 @@ void ResourceEditorWidget::slotPropertyContextMenu( const QPoint& pos )
     QTableView* view = qobject_cast<QTableView*>( sender() );
     QModelIndex index = view->indexAt( pos );
     if ( index.isValid() ) {
+        // act on the whole selection if the click was inside of it
+        QModelIndexList indexes = view->selectionModel()->selectedRows();
+        if( !view->selectionModel()->isRowSelected( index.row(), QModelIndex() ) ) {
+            indexes.clear();
+            indexes << index;
+        }
+
         QList<QAction*> actions;
 
         KAction actionDelete(this);
-        actionDelete.setText( i18n("Delete statement") );
+        actionDelete.setText( i18np("Delete statement", "Delete %1 statements", indexes.count()) );
         actionDelete.setIcon( KIcon( QLatin1String( "edit-delete" ) ) );
         actions.append( &actionDelete );
 
         QAction* a = QMenu::exec( actions,
                                   view->viewport()->mapToGlobal( pos ) );
         if( a == &actionDelete ) {
-            view->model()->removeRow( index.row() );
+            if( !qobject_cast<Nepomuk2::ResourcePropertyEditModel*>( view->model() )->removeStatements( indexes ) )
+                KMessageBox::sorry( this, i18np( "The statement could not be deleted.",
+                                                 "The statements could not be deleted.",
+                                                 indexes.count() ) );
         }
     }
 
@@ -104,13 +149,24 @@ void ResourceEditorWidget::slotPropertyContextMenu( const QPoint& pos )
 
 void ResourceEditorWidget::slotNodeActivated( const QModelIndex& index )
 {
-    Soprano::Node node = qobject_cast<const Nepomuk2::ResourcePropertyEditModel*>( index.model() )->nodeForIndex( index );
+    const Nepomuk2::ResourcePropertyEditModel* model = qobject_cast<const Nepomuk2::ResourcePropertyEditModel*>( index.model() );
+    Soprano::Node node = model->nodeForIndex( index );
     if ( node.isValid() && node.isResource() ) {
         Nepomuk2::Resource res = Nepomuk2::Resource::fromResourceUri( node.uri() );
         if( res.exists() ) {
             emit resourceActivated( res );
         }
     }
+    else if( model == m_propertyModel && m_propertyModel->isPartial( index ) ) {
+        // long values are edited once they are loaded completely, see slotFullValueLoaded()
+        m_propertyModel->loadFullValue( index );
+    }
+}
+
+
+void ResourceEditorWidget::slotFullValueLoaded( const QModelIndex& index )
+{
+    m_propertyView->edit( index );
 }
 
 
@@ -134,13 +190,156 @@ void ResourceEditorWidget::slotResourceHistoryForward()
 }
 
 
+void ResourceEditorWidget::slotPropertyCountChanged( int count )
+{
+    // the models only load the first rows, the rest is fetched while scrolling
+    if( count < 0 )
+        m_propertiesLabel->setText( i18n( "Properties:" ) );
+    else
+        m_propertiesLabel->setText( i18np( "Properties (1):", "Properties (%1):", count ) );
+}
+
+
+void ResourceEditorWidget::slotBacklinkCountChanged( int count )
+{
+    if( count < 0 )
+        m_backlinksLabel->setText( i18n( "Backlinks:" ) );
+    else
+        m_backlinksLabel->setText( i18np( "Backlinks (1):", "Backlinks (%1):", count ) );
+}
+
+
+void ResourceEditorWidget::slotWatchedResourceChanged( const Nepomuk2::Resource& res, const Nepomuk2::Types::Property& property )
+{
+    removeSnapshot( res.uri() );
+    if( res.uri() == m_resource.uri() )
+        m_propertyModel->propertyChanged( property );
+}
+
+
+void ResourceEditorWidget::slotWatchedResourceRemoved( const QUrl& uri )
+{
+    removeSnapshot( uri );
+    if( uri == m_resource.uri() ) {
+        m_propertyModel->reload();
+        m_backlinksModel->reload();
+    }
+}
+
+
 void ResourceEditorWidget::setResourceInternal( const Nepomuk2::Resource& res )
 {
     if( m_resource != res ) {
+        cacheCurrentResource();
+
+        const QUrl previousUri = m_resource.uri();
         m_resource = res;
-        m_propertyModel->setResource( res );
-        m_backlinksModel->setResource( res );
+
+        // the properties are kept up to date by the watcher, only the backlinks expire
+        const ResourceSnapshot* snapshot = findSnapshot( res.uri() );
+        if( snapshot ) {
+            m_propertyModel->setResource( res, snapshot->properties, snapshot->propertiesComplete );
+            if( snapshot->created.secsTo( QDateTime::currentDateTime() ) <= s_backlinkSnapshotMaxAge ) {
+                m_backlinksModel->setResource( res, snapshot->backlinks, snapshot->backlinksComplete );
+                m_backlinksLoaded = snapshot->created;
+            }
+            else {
+                m_backlinksModel->setResource( res );
+                m_backlinksLoaded = QDateTime::currentDateTime();
+            }
+        }
+        else {
+            // both models query asynchronously, the tables are filled as the results come in
+            m_propertyModel->setResource( res );
+            m_backlinksModel->setResource( res );
+            m_backlinksLoaded = QDateTime::currentDateTime();
+        }
         m_uriLabel->setText( KUrl(res.uri()).url() );
+        updateWatchedResource( previousUri );
+        updateWatchedResource( res.uri() );
+    }
+}
+
+
+void ResourceEditorWidget::cacheCurrentResource()
+{
+    // partially loaded tables are cached as well, paging continues once they are shown again
+    if( m_resource.isValid() &&
+        m_propertyModel->canRestore() &&
+        m_backlinksModel->canRestore() ) {
+        ResourceSnapshot snapshot;
+        snapshot.properties = m_propertyModel->statements();
+        snapshot.propertiesComplete = m_propertyModel->isComplete();
+        snapshot.backlinks = m_backlinksModel->statements();
+        snapshot.backlinksComplete = m_backlinksModel->isComplete();
+        snapshot.created = m_backlinksLoaded;
+        snapshot.cost = 1 + snapshot.properties.count() + snapshot.backlinks.count();
+        insertSnapshot( m_resource.uri(), snapshot );
+    }
+}
+
+
+const ResourceEditorWidget::ResourceSnapshot* ResourceEditorWidget::findSnapshot( const QUrl& uri )
+{
+    QHash<QUrl, ResourceSnapshot>::const_iterator it = m_snapshots.constFind( uri );
+    if( it == m_snapshots.constEnd() )
+        return 0;
+
+    // the most recently used snapshots are evicted last
+    m_snapshotOrder.removeOne( uri );
+    m_snapshotOrder.append( uri );
+    return &it.value();
+}
+
+
+void ResourceEditorWidget::insertSnapshot( const QUrl& uri, const ResourceSnapshot& snapshot )
+{
+    removeSnapshot( uri );
+    if( snapshot.cost > s_snapshotCacheSize )
+        return;
+
+    m_snapshots.insert( uri, snapshot );
+    m_snapshotOrder.append( uri );
+    m_snapshotCost += snapshot.cost;
+    updateWatchedResource( uri );
+
+    while( m_snapshotOrder.count() > s_maxSnapshots || m_snapshotCost > s_snapshotCacheSize ) {
+        removeSnapshot( m_snapshotOrder.first() );
+    }
+}
+
+
+void ResourceEditorWidget::removeSnapshot( const QUrl& uri )
+{
+    QHash<QUrl, ResourceSnapshot>::iterator it = m_snapshots.find( uri );
+    if( it != m_snapshots.end() ) {
+        m_snapshotCost -= it.value().cost;
+        m_snapshots.erase( it );
+        m_snapshotOrder.removeOne( uri );
+        updateWatchedResource( uri );
+    }
+}
+
+
+void ResourceEditorWidget::updateWatchedResource( const QUrl& uri )
+{
+    // The watcher is changed one resource at a time. Restarting it would register all
+    // cached resources again and lose the changes done in the meantime.
+    if( uri.isEmpty() )
+        return;
+
+    const bool watch = ( uri == m_resource.uri() || m_snapshots.contains( uri ) );
+    if( watch && !m_watchedResources.contains( uri ) ) {
+        m_watchedResources.insert( uri );
+        m_watcher->addResource( uri );
+        if( !m_watcherStarted ) {
+            m_watcher->start();
+            m_watcherStarted = true;
+        }
+    }
+    else if( !watch && m_watchedResources.contains( uri ) ) {
+        m_watchedResources.remove( uri );
+        m_watcher->removeResource( uri );
     }
 }
 
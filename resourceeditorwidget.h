@@ -23,14 +23,19 @@
 
 #include <QtGui/QWidget>
 #include <QtCore/QStack>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QDateTime>
 
 #include <Nepomuk2/Resource>
 #include <Nepomuk2/Types/Class>
+#include <Nepomuk2/Types/Property>
 
 #include "ui_resourceeditorwidget.h"
+#include "resourcepropertymodel.h"
 
 namespace Nepomuk2 {
-    class ResourcePropertyEditModel;
+    class ResourceWatcher;
 }
 
 class ResourceEditorWidget : public QWidget, private Ui::ResourceEditorWidget
@@ -52,12 +57,19 @@ public Q_SLOTS:
 private Q_SLOTS:
     void slotPropertyContextMenu( const QPoint& pos );
     void slotNodeActivated( const QModelIndex& index );
+    void slotFullValueLoaded( const QModelIndex& index );
     void slotResourceHistoryBack();
     void slotResourceHistoryForward();
+    void slotPropertyCountChanged( int count );
+    void slotBacklinkCountChanged( int count );
+    void slotWatchedResourceChanged( const Nepomuk2::Resource& res, const Nepomuk2::Types::Property& property );
+    void slotWatchedResourceRemoved( const QUrl& uri );
 
 private:
     void setResourceInternal( const Nepomuk2::Resource& res );
     void updateResourceHistoryButtonStates();
+    void cacheCurrentResource();
+    void updateWatchedResource( const QUrl& uri );
 
     Nepomuk2::ResourcePropertyEditModel* m_propertyModel;
     Nepomuk2::ResourcePropertyEditModel* m_backlinksModel;
@@ -65,6 +77,37 @@ private:
 
     QStack<QUrl> m_backStack;
     QStack<QUrl> m_forwardStack;
+
+    /// The loaded rows of recently viewed resources
+    struct ResourceSnapshot {
+        Nepomuk2::ResourcePropertyEditModel::StatementList properties;
+        bool propertiesComplete;
+        Nepomuk2::ResourcePropertyEditModel::StatementList backlinks;
+        bool backlinksComplete;
+
+        /// when the backlinks were loaded
+        QDateTime created;
+
+        /// the number of statements plus one
+        int cost;
+    };
+    const ResourceSnapshot* findSnapshot( const QUrl& uri );
+    void insertSnapshot( const QUrl& uri, const ResourceSnapshot& snapshot );
+    void removeSnapshot( const QUrl& uri );
+
+    QHash<QUrl, ResourceSnapshot> m_snapshots;
+
+    /// the cached resources, least recently used first
+    QList<QUrl> m_snapshotOrder;
+    int m_snapshotCost;
+
+    /// when the backlinks of the shown resource were queried
+    QDateTime m_backlinksLoaded;
+
+    /// Updates the shown resource and invalidates the snapshots of changed resources
+    Nepomuk2::ResourceWatcher* m_watcher;
+    QSet<QUrl> m_watchedResources;
+    bool m_watcherStarted;
 };
 
 #endif
@@ -0,0 +1,560 @@
+/*
+   Copyright (c) 2010 Sebastian Trueg <trueg@kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "resourcegraphwidget.h"
+
+#include <nepomuk2/resourcemanager.h>
+#include <nepomuk2/nie.h>
+#include <nepomuk2/nco.h>
+#include <nepomuk2/nfo.h>
+
+#include <QtGui/QGraphicsScene>
+#include <QtGui/QGraphicsEllipseItem>
+#include <QtGui/QGraphicsSimpleTextItem>
+#include <QtGui/QGraphicsLineItem>
+#include <QtGui/QPen>
+#include <QtGui/QMouseEvent>
+#include <QtCore/QStringList>
+#include <QtCore/QtConcurrentRun>
+#include <QtCore/qmath.h>
+
+#include <Soprano/Model>
+#include <Soprano/Node>
+#include <Soprano/Vocabulary/RDF>
+#include <Soprano/Vocabulary/RDFS>
+#include <Soprano/Vocabulary/NAO>
+#include <Soprano/Util/AsyncQuery>
+
+#include <KIcon>
+#include <KLocale>
+#include <KDebug>
+
+
+namespace {
+/// The maximum number of new nodes added with one expansion
+const int s_maxNodesPerLevel = 100;
+
+/// The maximum number of nodes in the whole graph
+const int s_maxNodes = 1000;
+
+/// The number of resources whose neighbors are requested with one query
+const int s_neighborBatchSize = 50;
+
+/// The maximum number of neighbors shown per resource, hubs only show a sample
+const int s_maxNeighborsPerResource = 20;
+
+/// The layout runs in steps of this many iterations, the view is updated in between
+const int s_layoutIterationsPerStep = 20;
+
+/// The preferred edge length
+const qreal s_edgeLength = 80.0;
+
+const qreal s_nodeRadius = 6.0;
+
+/**
+ * A few iterations of the Fruchterman-Reingold layout. The first node is
+ * the center resource and stays in place.
+ */
+QVector<QPointF> layoutGraph( QVector<QPointF> pos, const QList<QPair<int, int> >& edges, qreal temperature )
+{
+    const int n = pos.count();
+    const qreal k2 = s_edgeLength*s_edgeLength;
+
+    for( int iteration = 0; iteration < s_layoutIterationsPerStep; ++iteration ) {
+        QVector<QPointF> disp( n );
+
+        for( int i = 0; i < n; ++i ) {
+            for( int j = i+1; j < n; ++j ) {
+                QPointF delta = pos[i] - pos[j];
+                qreal dist2 = delta.x()*delta.x() + delta.y()*delta.y();
+                if( dist2 < 0.01 ) {
+                    delta = QPointF( 0.1*(i-j), 0.1 );
+                    dist2 = 0.01;
+                }
+                // k^2/d in the direction of delta
+                const QPointF force = delta * ( k2 / dist2 );
+                disp[i] += force;
+                disp[j] -= force;
+            }
+        }
+
+        for( int e = 0; e < edges.count(); ++e ) {
+            const int a = edges[e].first;
+            const int b = edges[e].second;
+            const QPointF delta = pos[a] - pos[b];
+            const qreal dist = qSqrt( delta.x()*delta.x() + delta.y()*delta.y() );
+            // d^2/k in the direction of delta
+            const QPointF force = delta * ( dist / s_edgeLength );
+            disp[a] -= force;
+            disp[b] += force;
+        }
+
+        for( int i = 1; i < n; ++i ) {
+            const qreal len = qSqrt( disp[i].x()*disp[i].x() + disp[i].y()*disp[i].y() );
+            if( len > 0.0 )
+                pos[i] += disp[i] / len * qMin( len, temperature );
+        }
+
+        temperature *= 0.95;
+    }
+
+    return pos;
+}
+}
+
+
+ResourceGraphWidget::ResourceGraphWidget( QWidget* parent )
+    : QWidget( parent ),
+      m_level( 0 ),
+      m_levelTruncated( false ),
+      m_newNodesInLevel( 0 ),
+      m_neighborQuery( 0 ),
+      m_neighborRows( 0 ),
+      m_neighborLimit( 0 ),
+      m_labelQuery( 0 ),
+      m_layoutTemperature( 0.0 ),
+      m_layoutDirty( false ),
+      m_layoutStale( false )
+{
+    setupUi( this );
+
+    m_scene = new QGraphicsScene( this );
+    m_graphView->setScene( m_scene );
+    m_graphView->viewport()->installEventFilter( this );
+
+    m_buttonExpand->setIcon( KIcon( QLatin1String( "zoom-in" ) ) );
+    m_buttonExpand->setToolTip( i18n( "Add the neighbors of the outermost resources" ) );
+
+    connect( m_buttonExpand, SIGNAL(clicked()),
+             this, SLOT(expand()) );
+    connect( &m_layoutWatcher, SIGNAL(finished()),
+             this, SLOT(slotLayoutFinished()) );
+
+    updateStatus();
+}
+
+
+ResourceGraphWidget::~ResourceGraphWidget()
+{
+    clear();
+    m_layoutWatcher.waitForFinished();
+}
+
+
+void ResourceGraphWidget::setResource( const Nepomuk2::Resource& res )
+{
+    if( m_resource != res ) {
+        clear();
+        m_resource = res;
+        if( res.isValid() ) {
+            addNode( res.uri(), 0, QPointF( 0, 0 ) );
+            startLabelQuery( QList<QUrl>() << res.uri() );
+            expand();
+        }
+        updateStatus();
+    }
+}
+
+
+void ResourceGraphWidget::expand()
+{
+    if( m_nodes.isEmpty() || m_neighborQuery || !m_expansionQueue.isEmpty() || !m_singleExpansionQueue.isEmpty() ||
+        m_nodes.count() >= s_maxNodes )
+        return;
+
+    for( int i = 0; i < m_nodes.count(); ++i ) {
+        if( m_nodes[i].level == m_level )
+            m_expansionQueue << m_nodes[i].uri;
+    }
+    m_newNodesInLevel = 0;
+    m_levelTruncated = false;
+
+    startNextNeighborQuery();
+    updateStatus();
+}
+
+
+bool ResourceGraphWidget::eventFilter( QObject* watched, QEvent* event )
+{
+    if( watched == m_graphView->viewport() && event->type() == QEvent::MouseButtonDblClick ) {
+        QMouseEvent* me = static_cast<QMouseEvent*>( event );
+        QGraphicsItem* item = m_graphView->itemAt( me->pos() );
+        if( item && item->parentItem() )
+            item = item->parentItem();
+        if( item && !item->data( 0 ).isNull() ) {
+            emit resourceActivated( Nepomuk2::Resource::fromResourceUri( item->data( 0 ).toUrl() ) );
+            return true;
+        }
+    }
+    return QWidget::eventFilter( watched, event );
+}
+
+
+void ResourceGraphWidget::clear()
+{
+    if( m_neighborQuery ) {
+        m_neighborQuery->disconnect( this );
+        m_neighborQuery->close();
+        m_neighborQuery = 0;
+    }
+    if( m_labelQuery ) {
+        m_labelQuery->disconnect( this );
+        m_labelQuery->close();
+        m_labelQuery = 0;
+    }
+
+    // a running layout step does not match the graph anymore
+    m_layoutStale = m_layoutWatcher.isRunning();
+    m_layoutDirty = false;
+    m_scene->clear();
+    m_nodes.clear();
+    m_nodeIndex.clear();
+    m_edges.clear();
+    m_edgeSet.clear();
+    m_edgeItems.clear();
+    m_expansionQueue.clear();
+    m_singleExpansionQueue.clear();
+    m_neighborBatch.clear();
+    m_neighborCounts.clear();
+    m_labelQueue.clear();
+    m_level = 0;
+    m_levelTruncated = false;
+    m_newNodesInLevel = 0;
+    m_resource = Nepomuk2::Resource();
+}
+
+
+int ResourceGraphWidget::addNode( const QUrl& uri, int level, const QPointF& pos )
+{
+    GraphNode node;
+    node.uri = uri;
+    node.level = level;
+
+    node.item = m_scene->addEllipse( -s_nodeRadius, -s_nodeRadius, 2*s_nodeRadius, 2*s_nodeRadius,
+                                     QPen( palette().color( QPalette::Text ) ),
+                                     level == 0 ? palette().highlight() : palette().base() );
+    node.item->setPos( pos );
+    node.item->setZValue( 1 );
+    node.item->setData( 0, uri );
+    node.item->setToolTip( uri.toString() );
+
+    node.label = new QGraphicsSimpleTextItem( node.item );
+    node.label->setPos( s_nodeRadius + 2, -s_nodeRadius );
+    node.label->setText( uri.fragment().isEmpty() ? uri.toString().section( QLatin1Char( '/' ), -1 ) : uri.fragment() );
+
+    node.truncated = false;
+
+    m_nodes.append( node );
+    m_nodeIndex.insert( uri, m_nodes.count() - 1 );
+    return m_nodes.count() - 1;
+}
+
+
+void ResourceGraphWidget::setTruncated( int index )
+{
+    GraphNode& node = m_nodes[index];
+    if( !node.truncated ) {
+        node.truncated = true;
+        QPen pen = node.item->pen();
+        pen.setStyle( Qt::DashLine );
+        node.item->setPen( pen );
+        node.item->setToolTip( node.uri.toString() + QLatin1Char( '\n' ) +
+                               i18np( "Only the first link is shown", "Only the first %1 links are shown", s_maxNeighborsPerResource ) );
+    }
+}
+
+
+void ResourceGraphWidget::addEdge( int from, int to )
+{
+    if( from == to )
+        return;
+
+    const QPair<int, int> edge( qMin( from, to ), qMax( from, to ) );
+    if( !m_edgeSet.contains( edge ) ) {
+        m_edgeSet.insert( edge );
+        m_edges.append( edge );
+        QGraphicsLineItem* item = m_scene->addLine( QLineF( m_nodes[from].item->pos(), m_nodes[to].item->pos() ),
+                                                    QPen( palette().color( QPalette::Mid ) ) );
+        m_edgeItems.append( item );
+    }
+}
+
+
+void ResourceGraphWidget::startNextNeighborQuery()
+{
+    // resources whose neighbors did not fit into a batch come first, each on its own
+    m_neighborBatch.clear();
+    m_neighborCounts.clear();
+    if( !m_singleExpansionQueue.isEmpty() ) {
+        m_neighborBatch << m_singleExpansionQueue.takeFirst();
+    }
+    else {
+        for( int i = 0; i < s_neighborBatchSize && !m_expansionQueue.isEmpty(); ++i ) {
+            m_neighborBatch << m_expansionQueue.takeFirst();
+        }
+    }
+    if( m_neighborBatch.isEmpty() )
+        return;
+
+    QStringList resources;
+    Q_FOREACH( const QUrl& uri, m_neighborBatch ) {
+        resources << Soprano::Node::resourceToN3( uri );
+    }
+
+    // Links in both directions. Types are ignored since every resource of a type would
+    // end up connected through it. The resources are filtered in each branch so that the
+    // store never evaluates an unbound pattern. One more row per resource than we show
+    // tells us which of them are hubs.
+    m_neighborRows = 0;
+    m_neighborLimit = m_neighborBatch.count() * ( s_maxNeighborsPerResource + 1 );
+    const QString query = QString::fromLatin1( "select distinct ?r ?n where { "
+                                               "{ ?r ?p ?n . FILTER(?r in (%1) && isIRI(?n) && ?p != %2) . } "
+                                               "UNION "
+                                               "{ ?n ?p ?r . FILTER(?r in (%1) && ?p != %2) . } "
+                                               "} LIMIT %3" )
+                          .arg( resources.join( QLatin1String( "," ) ),
+                                Soprano::Node::resourceToN3( Soprano::Vocabulary::RDF::type() ),
+                                QString::number( m_neighborLimit ) );
+
+    m_neighborQuery = Soprano::Util::AsyncQuery::executeQuery( Nepomuk2::ResourceManager::instance()->mainModel(),
+                                                               query,
+                                                               Soprano::Query::QueryLanguageSparql );
+    connect( m_neighborQuery, SIGNAL(nextReady(Soprano::Util::AsyncQuery*)),
+             this, SLOT(slotNeighborResultReady(Soprano::Util::AsyncQuery*)) );
+    connect( m_neighborQuery, SIGNAL(finished(Soprano::Util::AsyncQuery*)),
+             this, SLOT(slotNeighborQueryFinished(Soprano::Util::AsyncQuery*)) );
+}
+
+
+void ResourceGraphWidget::slotNeighborResultReady( Soprano::Util::AsyncQuery* query )
+{
+    const QUrl resource = query->binding( QLatin1String( "r" ) ).uri();
+    const QUrl neighbor = query->binding( QLatin1String( "n" ) ).uri();
+    ++m_neighborRows;
+
+    const int from = m_nodeIndex.value( resource, -1 );
+    int to = m_nodeIndex.value( neighbor, -1 );
+    if( from >= 0 && ++m_neighborCounts[resource] > s_maxNeighborsPerResource ) {
+        setTruncated( from );
+    }
+    else if( from >= 0 ) {
+        if( to < 0 ) {
+            if( m_newNodesInLevel < s_maxNodesPerLevel && m_nodes.count() < s_maxNodes ) {
+                // start close to the parent, the layout does the rest
+                const qreal angle = qreal( m_nodes.count() ) * 2.4;
+                const QPointF pos = m_nodes[from].item->pos() + QPointF( qCos( angle ), qSin( angle ) ) * s_edgeLength * 0.5;
+                to = addNode( neighbor, m_level + 1, pos );
+                m_labelQueue << neighbor;
+                ++m_newNodesInLevel;
+            }
+            else {
+                m_levelTruncated = true;
+            }
+        }
+        if( to >= 0 )
+            addEdge( from, to );
+    }
+
+    query->next();
+}
+
+
+void ResourceGraphWidget::slotNeighborQueryFinished( Soprano::Util::AsyncQuery* query )
+{
+    m_neighborQuery = 0;
+    if( query->lastError() ) {
+        kDebug() << query->lastError();
+    }
+    else if( m_neighborRows >= m_neighborLimit && m_neighborBatch.count() > 1 ) {
+        // The hubs of the batch used up the limit. The other resources might have
+        // lost some of their neighbors, they are expanded on their own.
+        Q_FOREACH( const QUrl& uri, m_neighborBatch ) {
+            if( m_neighborCounts.value( uri ) <= s_maxNeighborsPerResource )
+                m_singleExpansionQueue << uri;
+        }
+    }
+
+    if( !m_labelQueue.isEmpty() && !m_labelQuery ) {
+        startLabelQuery( m_labelQueue );
+        m_labelQueue.clear();
+    }
+    startLayout();
+
+    if( m_newNodesInLevel >= s_maxNodesPerLevel ) {
+        m_levelTruncated = true;
+        m_expansionQueue.clear();
+        m_singleExpansionQueue.clear();
+    }
+
+    if( !m_expansionQueue.isEmpty() || !m_singleExpansionQueue.isEmpty() ) {
+        startNextNeighborQuery();
+    }
+    else if( m_newNodesInLevel > 0 ) {
+        ++m_level;
+    }
+    updateStatus();
+}
+
+
+void ResourceGraphWidget::startLabelQuery( const QList<QUrl>& resources )
+{
+    QStringList resourceNodes;
+    Q_FOREACH( const QUrl& uri, resources ) {
+        resourceNodes << Soprano::Node::resourceToN3( uri );
+    }
+
+    const QString query = QString::fromLatin1( "select ?r ?l where { ?r ?p ?l . FILTER(?r in (%1)) . FILTER(?p in (%2)) . }" )
+                          .arg( resourceNodes.join( QLatin1String( "," ) ),
+                                ( QStringList()
+                                  << Soprano::Node::resourceToN3( Soprano::Vocabulary::NAO::prefLabel() )
+                                  << Soprano::Node::resourceToN3( Soprano::Vocabulary::RDFS::label() )
+                                  << Soprano::Node::resourceToN3( Nepomuk2::Vocabulary::NIE::title() )
+                                  << Soprano::Node::resourceToN3( Nepomuk2::Vocabulary::NCO::fullname() )
+                                  << Soprano::Node::resourceToN3( Nepomuk2::Vocabulary::NFO::fileName() ) )
+                                .join( QLatin1String( "," ) ) );
+
+    m_labelQuery = Soprano::Util::AsyncQuery::executeQuery( Nepomuk2::ResourceManager::instance()->mainModel(),
+                                                            query,
+                                                            Soprano::Query::QueryLanguageSparql );
+    connect( m_labelQuery, SIGNAL(nextReady(Soprano::Util::AsyncQuery*)),
+             this, SLOT(slotLabelResultReady(Soprano::Util::AsyncQuery*)) );
+    connect( m_labelQuery, SIGNAL(finished(Soprano::Util::AsyncQuery*)),
+             this, SLOT(slotLabelQueryFinished(Soprano::Util::AsyncQuery*)) );
+}
+
+
+void ResourceGraphWidget::slotLabelResultReady( Soprano::Util::AsyncQuery* query )
+{
+    const int i = m_nodeIndex.value( query->binding( QLatin1String( "r" ) ).uri(), -1 );
+    if( i >= 0 ) {
+        m_nodes[i].label->setText( query->binding( QLatin1String( "l" ) ).toString() );
+    }
+    query->next();
+}
+
+
+void ResourceGraphWidget::slotLabelQueryFinished( Soprano::Util::AsyncQuery* query )
+{
+    m_labelQuery = 0;
+    if( query->lastError() ) {
+        kDebug() << query->lastError();
+    }
+
+    // labels of nodes which were added in the meantime
+    if( !m_labelQueue.isEmpty() ) {
+        startLabelQuery( m_labelQueue );
+        m_labelQueue.clear();
+    }
+}
+
+
+void ResourceGraphWidget::startLayout()
+{
+    m_layoutTemperature = s_edgeLength;
+    if( m_layoutWatcher.isRunning() ) {
+        // restarted once the current step is done
+        m_layoutDirty = true;
+        return;
+    }
+
+    m_layoutDirty = false;
+    QVector<QPointF> positions( m_nodes.count() );
+    for( int i = 0; i < m_nodes.count(); ++i ) {
+        positions[i] = m_nodes[i].item->pos();
+    }
+    m_layoutWatcher.setFuture( QtConcurrent::run( layoutGraph, positions, m_edges, m_layoutTemperature ) );
+}
+
+
+void ResourceGraphWidget::slotLayoutFinished()
+{
+    const QVector<QPointF> positions = m_layoutWatcher.result();
+
+    if( m_layoutStale ) {
+        m_layoutStale = false;
+        if( !m_nodes.isEmpty() )
+            startLayout();
+        return;
+    }
+
+    // the graph might have been extended while we were computing
+    if( positions.count() <= m_nodes.count() ) {
+        for( int i = 0; i < positions.count(); ++i ) {
+            m_nodes[i].item->setPos( positions[i] );
+        }
+        updateEdges();
+    }
+
+    if( m_layoutDirty ) {
+        startLayout();
+    }
+    else {
+        m_layoutTemperature *= qPow( 0.95, s_layoutIterationsPerStep );
+        if( m_layoutTemperature > 1.0 && !m_nodes.isEmpty() ) {
+            QVector<QPointF> positions( m_nodes.count() );
+            for( int i = 0; i < m_nodes.count(); ++i ) {
+                positions[i] = m_nodes[i].item->pos();
+            }
+            m_layoutWatcher.setFuture( QtConcurrent::run( layoutGraph, positions, m_edges, m_layoutTemperature ) );
+        }
+    }
+}
+
+
+void ResourceGraphWidget::updateEdges()
+{
+    for( int i = 0; i < m_edges.count(); ++i ) {
+        m_edgeItems[i]->setLine( QLineF( m_nodes[m_edges[i].first].item->pos(),
+                                         m_nodes[m_edges[i].second].item->pos() ) );
+    }
+}
+
+
+void ResourceGraphWidget::updateStatus()
+{
+    m_buttonExpand->setEnabled( !m_nodes.isEmpty() &&
+                                !m_neighborQuery &&
+                                m_nodes.count() < s_maxNodes );
+
+    if( m_nodes.isEmpty() ) {
+        m_statusLabel->clear();
+    }
+    else {
+        QString status = i18np( "1 resource", "%1 resources", m_nodes.count() )
+                         + QLatin1String( ", " )
+                         + i18np( "1 level", "%1 levels", m_level );
+        if( m_levelTruncated )
+            status += QLatin1String( " " ) + i18np( "(only the first resource of the last level is shown)",
+                                                    "(only the first %1 resources of the last level are shown)",
+                                                    s_maxNodesPerLevel );
+        int truncated = 0;
+        Q_FOREACH( const GraphNode& node, m_nodes ) {
+            if( node.truncated )
+                ++truncated;
+        }
+        if( truncated > 0 )
+            status += QLatin1String( ", " ) + i18np( "1 resource with more links than shown (dashed)",
+                                                     "%1 resources with more links than shown (dashed)",
+                                                     truncated );
+        m_statusLabel->setText( status );
+    }
+}
+
+#include "resourcegraphwidget.moc"
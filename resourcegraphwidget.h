@@ -0,0 +1,149 @@
+/*
+   Copyright (c) 2010 Sebastian Trueg <trueg@kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _NEPOMUK_RESOURCE_GRAPH_WIDGET_H_
+#define _NEPOMUK_RESOURCE_GRAPH_WIDGET_H_
+
+#include <QtGui/QWidget>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QPair>
+#include <QtCore/QVector>
+#include <QtCore/QPointF>
+#include <QtCore/QFutureWatcher>
+
+#include <Nepomuk2/Resource>
+
+#include "ui_resourcegraphwidget.h"
+
+class QGraphicsScene;
+class QGraphicsEllipseItem;
+class QGraphicsSimpleTextItem;
+class QGraphicsLineItem;
+
+namespace Soprano {
+    namespace Util {
+        class AsyncQuery;
+    }
+}
+
+/**
+ * Shows a resource and its neighborhood as a graph which is expanded
+ * one level at a time.
+ *
+ * The neighbors of a whole level are fetched with one query per batch of
+ * resources. The number of neighbors per resource and the number of new
+ * nodes per level are capped. Thus, hubs with thousands of links only show
+ * a sample of their neighbors and are drawn dashed.
+ *
+ * The nodes are placed with a force-directed layout which runs in a
+ * worker thread, a few iterations at a time.
+ */
+class ResourceGraphWidget : public QWidget, private Ui::ResourceGraphWidget
+{
+    Q_OBJECT
+
+public:
+    ResourceGraphWidget( QWidget* parent = 0 );
+    ~ResourceGraphWidget();
+
+    Nepomuk2::Resource resource() const { return m_resource; }
+
+    bool eventFilter( QObject* watched, QEvent* event );
+
+Q_SIGNALS:
+    void resourceActivated( const Nepomuk2::Resource& res );
+
+public Q_SLOTS:
+    void setResource( const Nepomuk2::Resource& res );
+
+    /**
+     * Add the neighbors of the outermost level.
+     */
+    void expand();
+
+private Q_SLOTS:
+    void slotNeighborResultReady( Soprano::Util::AsyncQuery* query );
+    void slotNeighborQueryFinished( Soprano::Util::AsyncQuery* query );
+    void slotLabelResultReady( Soprano::Util::AsyncQuery* query );
+    void slotLabelQueryFinished( Soprano::Util::AsyncQuery* query );
+    void slotLayoutFinished();
+
+private:
+    struct GraphNode {
+        QUrl uri;
+        int level;
+        QGraphicsEllipseItem* item;
+        QGraphicsSimpleTextItem* label;
+
+        /// true if the resource has more neighbors than shown
+        bool truncated;
+    };
+
+    void clear();
+    int addNode( const QUrl& uri, int level, const QPointF& pos );
+    void addEdge( int from, int to );
+    void setTruncated( int index );
+    void startNextNeighborQuery();
+    void startLabelQuery( const QList<QUrl>& resources );
+    void startLayout();
+    void updateEdges();
+    void updateStatus();
+
+    Nepomuk2::Resource m_resource;
+
+    QGraphicsScene* m_scene;
+
+    QList<GraphNode> m_nodes;
+    QHash<QUrl, int> m_nodeIndex;
+    QList<QPair<int, int> > m_edges;
+    QSet<QPair<int, int> > m_edgeSet;
+    QList<QGraphicsLineItem*> m_edgeItems;
+
+    /// the deepest level shown so far
+    int m_level;
+
+    /// true if the last expansion hit the node cap
+    bool m_levelTruncated;
+    int m_newNodesInLevel;
+
+    /// the resources of the current level still to query
+    QList<QUrl> m_expansionQueue;
+
+    /// the resources which did not get all their neighbors in a batch, they are queried one by one
+    QList<QUrl> m_singleExpansionQueue;
+
+    /// the resources of the running neighbor query and the rows received for each of them
+    QList<QUrl> m_neighborBatch;
+    QHash<QUrl, int> m_neighborCounts;
+    int m_neighborRows;
+    int m_neighborLimit;
+    Soprano::Util::AsyncQuery* m_neighborQuery;
+
+    QList<QUrl> m_labelQueue;
+    Soprano::Util::AsyncQuery* m_labelQuery;
+
+    QFutureWatcher<QVector<QPointF> > m_layoutWatcher;
+    qreal m_layoutTemperature;
+    bool m_layoutDirty;
+    bool m_layoutStale;
+};
+
+#endif
@@ -0,0 +1,713 @@
+/*
+   Copyright (C) 2010 by Sebastian Trueg <trueg at kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resourcelistproxymodel.h"
+
+// Migrated classes
+#include "utils/resourcemodel.h"
+
+#include <QtCore/QVector>
+#include <QtCore/QDateTime>
+#include <QtCore/QStringList>
+
+#include <KDebug>
+
+#include <algorithm>
+
+
+namespace {
+    /// The keys cached for each row
+    enum KeyFlags {
+        LabelKey = 0x1,
+        TypeKey = 0x2,
+        CreationDateKey = 0x4
+    };
+}
+
+
+class Nepomuk2::ResourceListProxyModel::Private
+{
+public:
+    Private( ResourceListProxyModel* parent )
+        : m_sortKey( SourceOrder ),
+          m_sortOrder( Qt::AscendingOrder ),
+          q( parent ) {
+    }
+
+    struct Entry {
+        Entry()
+            : keys( 0 ) {
+        }
+
+        // case folded labels which are used for sorting and filtering
+        QString label;
+        QString type;
+        QDateTime created;
+
+        // the KeyFlags which have been fetched
+        int keys;
+    };
+
+    class RowLessThan
+    {
+    public:
+        RowLessThan( const Private* d )
+            : m_d( d ) {
+        }
+
+        bool operator()( int a, int b ) const {
+            return m_d->lessThan( a, b );
+        }
+
+    private:
+        const Private* m_d;
+    };
+
+    SortKey m_sortKey;
+    Qt::SortOrder m_sortOrder;
+    QString m_filterString;
+    QStringList m_filterWords;
+
+    /// the cached keys indexed by source row
+    QVector<Entry> m_entries;
+
+    /// all source rows in sort order
+    QVector<int> m_sorted;
+
+    /// the source rows which pass the filter in sort order, ie. the proxy rows
+    QVector<int> m_visible;
+
+    /// the proxy row of each source row or -1 if the row is filtered
+    QVector<int> m_sourceToProxy;
+
+    int requiredKeys() const;
+    void updateKeys( int first, int last, bool force = false );
+    bool lessThan( int a, int b ) const;
+    bool acceptsRow( int sourceRow ) const;
+
+    void sortRows( QVector<int>& rows ) const;
+    QVector<int> merge( const QVector<int>& a, const QVector<int>& b ) const;
+    QVector<int> filter( const QVector<int>& rows ) const;
+
+    void sortAll();
+    void rebuild();
+    void setVisible( const QVector<int>& rows );
+    void reposition( QVector<int> rows );
+    void permute( const QVector<int>& rows );
+    void rebuildSourceToProxy();
+
+private:
+    ResourceListProxyModel* q;
+};
+
+
+int Nepomuk2::ResourceListProxyModel::Private::requiredKeys() const
+{
+    int keys = 0;
+    switch( m_sortKey ) {
+    case SortByLabel:
+        keys |= LabelKey;
+        break;
+    case SortByType:
+        keys |= TypeKey|LabelKey;
+        break;
+    case SortByCreationDate:
+        keys |= CreationDateKey;
+        break;
+    case SourceOrder:
+        break;
+    }
+    if( !m_filterWords.isEmpty() ) {
+        keys |= LabelKey|TypeKey;
+    }
+    return keys;
+}
+
+
+void Nepomuk2::ResourceListProxyModel::Private::updateKeys( int first, int last, bool force )
+{
+    const int keys = requiredKeys();
+    if( !keys && !force )
+        return;
+
+    QAbstractItemModel* model = q->sourceModel();
+    for( int row = first; row <= last; ++row ) {
+        Entry& entry = m_entries[row];
+        if( force )
+            entry.keys = 0;
+
+        const int missing = keys & ~entry.keys;
+        if( missing & LabelKey ) {
+            entry.label = model->index( row, Utils::ResourceModel::ResourceColumn ).data( Qt::DisplayRole ).toString().toCaseFolded();
+        }
+        if( missing & TypeKey ) {
+            entry.type = model->index( row, Utils::ResourceModel::ResourceTypeColumn ).data( Qt::DisplayRole ).toString().toCaseFolded();
+        }
+        if( missing & CreationDateKey ) {
+            entry.created = model->index( row, Utils::ResourceModel::ResourceColumn ).data( Utils::ResourceModel::ResourceCreationDateRole ).toDateTime();
+        }
+        entry.keys |= missing;
+    }
+}
+
+
+bool Nepomuk2::ResourceListProxyModel::Private::lessThan( int a, int b ) const
+{
+    const Entry& ea = m_entries[a];
+    const Entry& eb = m_entries[b];
+
+    int c = 0;
+    switch( m_sortKey ) {
+    case SortByType:
+        c = ea.type.compare( eb.type );
+        if( c )
+            break;
+        // fallthrough to sort by label within one type
+
+    case SortByLabel:
+        c = ea.label.compare( eb.label );
+        break;
+
+    case SortByCreationDate:
+        if( ea.created < eb.created )
+            c = -1;
+        else if( eb.created < ea.created )
+            c = 1;
+        break;
+
+    case SourceOrder:
+        break;
+    }
+
+    // the source row makes the order total which is what allows us to merge
+    if( !c )
+        c = a - b;
+
+    return m_sortOrder == Qt::AscendingOrder ? c < 0 : c > 0;
+}
+
+
+bool Nepomuk2::ResourceListProxyModel::Private::acceptsRow( int sourceRow ) const
+{
+    const Entry& entry = m_entries[sourceRow];
+    Q_FOREACH( const QString& word, m_filterWords ) {
+        if( !entry.label.contains( word ) && !entry.type.contains( word ) )
+            return false;
+    }
+    return true;
+}
+
+
+void Nepomuk2::ResourceListProxyModel::Private::sortRows( QVector<int>& rows ) const
+{
+    if( m_sortKey != SourceOrder || m_sortOrder != Qt::AscendingOrder ) {
+        std::sort( rows.begin(), rows.end(), RowLessThan( this ) );
+    }
+}
+
+
+QVector<int> Nepomuk2::ResourceListProxyModel::Private::merge( const QVector<int>& a, const QVector<int>& b ) const
+{
+    QVector<int> result( a.count() + b.count() );
+    std::merge( a.constBegin(), a.constEnd(), b.constBegin(), b.constEnd(), result.begin(), RowLessThan( this ) );
+    return result;
+}
+
+
+QVector<int> Nepomuk2::ResourceListProxyModel::Private::filter( const QVector<int>& rows ) const
+{
+    if( m_filterWords.isEmpty() )
+        return rows;
+
+    QVector<int> result;
+    result.reserve( rows.count() );
+    Q_FOREACH( int row, rows ) {
+        if( acceptsRow( row ) )
+            result.append( row );
+    }
+    return result;
+}
+
+
+void Nepomuk2::ResourceListProxyModel::Private::sortAll()
+{
+    updateKeys( 0, m_entries.count()-1 );
+    m_sorted.resize( m_entries.count() );
+    for( int i = 0; i < m_sorted.count(); ++i ) {
+        m_sorted[i] = i;
+    }
+    sortRows( m_sorted );
+}
+
+
+void Nepomuk2::ResourceListProxyModel::Private::rebuild()
+{
+    sortAll();
+    setVisible( filter( m_sorted ) );
+}
+
+
+void Nepomuk2::ResourceListProxyModel::Private::rebuildSourceToProxy()
+{
+    m_sourceToProxy.fill( -1, m_entries.count() );
+    for( int i = 0; i < m_visible.count(); ++i ) {
+        m_sourceToProxy[m_visible[i]] = i;
+    }
+}
+
+
+void Nepomuk2::ResourceListProxyModel::Private::permute( const QVector<int>& rows )
+{
+    emit q->layoutAboutToBeChanged();
+
+    const QModelIndexList oldIndexes = q->persistentIndexList();
+    QVector<int> sourceRows;
+    sourceRows.reserve( oldIndexes.count() );
+    Q_FOREACH( const QModelIndex& index, oldIndexes ) {
+        sourceRows.append( m_visible[index.row()] );
+    }
+
+    m_visible = rows;
+    rebuildSourceToProxy();
+
+    QModelIndexList newIndexes;
+    for( int i = 0; i < oldIndexes.count(); ++i ) {
+        newIndexes.append( q->index( m_sourceToProxy[sourceRows[i]], oldIndexes[i].column() ) );
+    }
+    q->changePersistentIndexList( oldIndexes, newIndexes );
+
+    emit q->layoutChanged();
+}
+
+
+void Nepomuk2::ResourceListProxyModel::Private::setVisible( const QVector<int>& rows )
+{
+    //
+    // We translate the change into as few and as cheap signals as possible:
+    // rows which vanish are removed in one block, new rows are inserted in one
+    // block, and everything else is handled as a layout change. That way we
+    // never need more than one pass over the rows.
+    //
+
+    // 1. remove the rows which are no longer visible
+    QVector<bool> isTarget( m_entries.count(), false );
+    Q_FOREACH( int row, rows ) {
+        isTarget[row] = true;
+    }
+
+    QVector<int> kept, dropped;
+    kept.reserve( m_visible.count() );
+    Q_FOREACH( int row, m_visible ) {
+        if( isTarget[row] )
+            kept.append( row );
+        else
+            dropped.append( row );
+    }
+
+    if( !dropped.isEmpty() ) {
+        int firstDropped = m_sourceToProxy[dropped.first()];
+        if( m_sourceToProxy[dropped.last()] - firstDropped + 1 != dropped.count() ) {
+            // move the dropped rows to the end so they can be removed in one go
+            permute( kept + dropped );
+            firstDropped = kept.count();
+        }
+        q->beginRemoveRows( QModelIndex(), firstDropped, firstDropped + dropped.count() - 1 );
+        m_visible = kept;
+        rebuildSourceToProxy();
+        q->endRemoveRows();
+    }
+
+    // 2. insert the new rows
+    QVector<int> added;
+    int firstAdded = -1;
+    int lastAdded = -1;
+    int keptRow = 0;
+    bool keptInOrder = true;
+    for( int i = 0; i < rows.count(); ++i ) {
+        const int proxyRow = m_sourceToProxy[rows[i]];
+        if( proxyRow < 0 ) {
+            if( firstAdded < 0 )
+                firstAdded = i;
+            lastAdded = i;
+            added.append( rows[i] );
+        }
+        else if( proxyRow != keptRow++ ) {
+            keptInOrder = false;
+        }
+    }
+
+    if( !added.isEmpty() ) {
+        if( keptInOrder && lastAdded - firstAdded + 1 == added.count() ) {
+            // the typical case: a batch of rows which ends up in one block
+            q->beginInsertRows( QModelIndex(), firstAdded, lastAdded );
+            m_visible = rows;
+            rebuildSourceToProxy();
+            q->endInsertRows();
+            return;
+        }
+
+        q->beginInsertRows( QModelIndex(), m_visible.count(), m_visible.count() + added.count() - 1 );
+        m_visible += added;
+        rebuildSourceToProxy();
+        q->endInsertRows();
+    }
+
+    // 3. bring everything into the final order
+    if( m_visible != rows ) {
+        permute( rows );
+    }
+}
+
+
+void Nepomuk2::ResourceListProxyModel::Private::reposition( QVector<int> rows )
+{
+    // Take the rows out of the order and merge them back in. The other
+    // rows keep their relative order, thus, no complete sort is needed.
+    QVector<bool> isMoved( m_entries.count(), false );
+    Q_FOREACH( int row, rows ) {
+        isMoved[row] = true;
+    }
+
+    QVector<int> sorted;
+    sorted.reserve( m_sorted.count() );
+    Q_FOREACH( int row, m_sorted ) {
+        if( !isMoved[row] )
+            sorted.append( row );
+    }
+
+    QVector<int> visible;
+    visible.reserve( m_visible.count() );
+    Q_FOREACH( int row, m_visible ) {
+        if( !isMoved[row] )
+            visible.append( row );
+    }
+
+    sortRows( rows );
+    m_sorted = merge( sorted, rows );
+    setVisible( merge( visible, filter( rows ) ) );
+}
+
+
+Nepomuk2::ResourceListProxyModel::ResourceListProxyModel( QObject* parent )
+    : QAbstractProxyModel( parent ),
+      d( new Private( this ) )
+{
+}
+
+
+Nepomuk2::ResourceListProxyModel::~ResourceListProxyModel()
+{
+    delete d;
+}
+
+
+void Nepomuk2::ResourceListProxyModel::setSourceModel( QAbstractItemModel* model )
+{
+    if( sourceModel() ) {
+        sourceModel()->disconnect( this );
+    }
+
+    QAbstractProxyModel::setSourceModel( model );
+
+    if( model ) {
+        connect( model, SIGNAL(rowsInserted(QModelIndex,int,int)),
+                 this, SLOT(slotSourceRowsInserted(QModelIndex,int,int)) );
+        connect( model, SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)),
+                 this, SLOT(slotSourceRowsAboutToBeRemoved(QModelIndex,int,int)) );
+        connect( model, SIGNAL(rowsRemoved(QModelIndex,int,int)),
+                 this, SLOT(slotSourceRowsRemoved(QModelIndex,int,int)) );
+        connect( model, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+                 this, SLOT(slotSourceDataChanged(QModelIndex,QModelIndex)) );
+        connect( model, SIGNAL(modelReset()),
+                 this, SLOT(slotSourceReset()) );
+        connect( model, SIGNAL(layoutChanged()),
+                 this, SLOT(slotSourceReset()) );
+    }
+
+    slotSourceReset();
+}
+
+
+Nepomuk2::ResourceListProxyModel::SortKey Nepomuk2::ResourceListProxyModel::sortKey() const
+{
+    return d->m_sortKey;
+}
+
+
+Qt::SortOrder Nepomuk2::ResourceListProxyModel::sortOrder() const
+{
+    return d->m_sortOrder;
+}
+
+
+QString Nepomuk2::ResourceListProxyModel::filterString() const
+{
+    return d->m_filterString;
+}
+
+
+QModelIndex Nepomuk2::ResourceListProxyModel::mapToSource( const QModelIndex& proxyIndex ) const
+{
+    if( proxyIndex.isValid() && sourceModel() && proxyIndex.row() < d->m_visible.count() ) {
+        return sourceModel()->index( d->m_visible[proxyIndex.row()], proxyIndex.column() );
+    }
+    else {
+        return QModelIndex();
+    }
+}
+
+
+QModelIndex Nepomuk2::ResourceListProxyModel::mapFromSource( const QModelIndex& sourceIndex ) const
+{
+    if( sourceIndex.isValid() && sourceIndex.row() < d->m_sourceToProxy.count() ) {
+        const int row = d->m_sourceToProxy[sourceIndex.row()];
+        if( row >= 0 )
+            return index( row, sourceIndex.column() );
+    }
+    return QModelIndex();
+}
+
+
+QModelIndex Nepomuk2::ResourceListProxyModel::index( int row, int column, const QModelIndex& parent ) const
+{
+    if( !parent.isValid() &&
+        row >= 0 && row < d->m_visible.count() &&
+        column >= 0 && column < columnCount() ) {
+        return createIndex( row, column );
+    }
+    else {
+        return QModelIndex();
+    }
+}
+
+
+QModelIndex Nepomuk2::ResourceListProxyModel::parent( const QModelIndex& index ) const
+{
+    Q_UNUSED( index );
+    return QModelIndex();
+}
+
+
+int Nepomuk2::ResourceListProxyModel::rowCount( const QModelIndex& parent ) const
+{
+    if( parent.isValid() )
+        return 0;
+    else
+        return d->m_visible.count();
+}
+
+
+int Nepomuk2::ResourceListProxyModel::columnCount( const QModelIndex& parent ) const
+{
+    if( parent.isValid() || !sourceModel() )
+        return 0;
+    else
+        return sourceModel()->columnCount();
+}
+
+
+QVariant Nepomuk2::ResourceListProxyModel::headerData( int section, Qt::Orientation orientation, int role ) const
+{
+    // the default implementation maps the section through the first row which fails on an empty model
+    if( sourceModel() && orientation == Qt::Horizontal ) {
+        return sourceModel()->headerData( section, orientation, role );
+    }
+    else {
+        return QAbstractProxyModel::headerData( section, orientation, role );
+    }
+}
+
+
+QMimeData* Nepomuk2::ResourceListProxyModel::mimeData( const QModelIndexList& indexes ) const
+{
+    QModelIndexList sourceIndexes;
+    Q_FOREACH( const QModelIndex& index, indexes ) {
+        sourceIndexes.append( mapToSource( index ) );
+    }
+    return sourceModel()->mimeData( sourceIndexes );
+}
+
+
+QStringList Nepomuk2::ResourceListProxyModel::mimeTypes() const
+{
+    return sourceModel()->mimeTypes();
+}
+
+
+void Nepomuk2::ResourceListProxyModel::sort( int column, Qt::SortOrder order )
+{
+    switch( column ) {
+    case Utils::ResourceModel::ResourceColumn:
+        setSortKey( SortByLabel, order );
+        break;
+    case Utils::ResourceModel::ResourceTypeColumn:
+        setSortKey( SortByType, order );
+        break;
+    default:
+        setSortKey( SourceOrder, Qt::AscendingOrder );
+        break;
+    }
+}
+
+
+void Nepomuk2::ResourceListProxyModel::setSortKey( SortKey key, Qt::SortOrder order )
+{
+    if( key != d->m_sortKey || order != d->m_sortOrder ) {
+        d->m_sortKey = key;
+        d->m_sortOrder = order;
+        d->rebuild();
+    }
+}
+
+
+void Nepomuk2::ResourceListProxyModel::setFilterString( const QString& filter )
+{
+    if( filter != d->m_filterString ) {
+        d->m_filterString = filter;
+        d->m_filterWords = filter.toCaseFolded().split( QLatin1Char( ' ' ), QString::SkipEmptyParts );
+
+        // the order does not change, thus, a pass over the sorted rows is all we need
+        d->updateKeys( 0, d->m_entries.count()-1 );
+        d->setVisible( d->filter( d->m_sorted ) );
+    }
+}
+
+
+void Nepomuk2::ResourceListProxyModel::slotSourceRowsInserted( const QModelIndex& parent, int first, int last )
+{
+    if( parent.isValid() )
+        return;
+
+    const int count = last - first + 1;
+
+    // 1. make room for the new rows
+    if( first < d->m_entries.count() ) {
+        for( int i = 0; i < d->m_sorted.count(); ++i ) {
+            if( d->m_sorted[i] >= first )
+                d->m_sorted[i] += count;
+        }
+        for( int i = 0; i < d->m_visible.count(); ++i ) {
+            if( d->m_visible[i] >= first )
+                d->m_visible[i] += count;
+        }
+    }
+    d->m_entries.insert( first, count, Private::Entry() );
+    d->rebuildSourceToProxy();
+    d->updateKeys( first, last );
+
+    // 2. sort the new rows on their own and merge them into the existing order
+    QVector<int> newRows( count );
+    for( int i = 0; i < count; ++i ) {
+        newRows[i] = first + i;
+    }
+    d->sortRows( newRows );
+
+    d->m_sorted = d->merge( d->m_sorted, newRows );
+    d->setVisible( d->merge( d->m_visible, d->filter( newRows ) ) );
+}
+
+
+void Nepomuk2::ResourceListProxyModel::slotSourceRowsAboutToBeRemoved( const QModelIndex& parent, int first, int last )
+{
+    if( parent.isValid() )
+        return;
+
+    QVector<int> remaining;
+    remaining.reserve( d->m_visible.count() );
+    Q_FOREACH( int row, d->m_visible ) {
+        if( row < first || row > last )
+            remaining.append( row );
+    }
+    d->setVisible( remaining );
+}
+
+
+void Nepomuk2::ResourceListProxyModel::slotSourceRowsRemoved( const QModelIndex& parent, int first, int last )
+{
+    if( parent.isValid() )
+        return;
+
+    // the proxy rows are gone already, we only need to update the source rows
+    const int count = last - first + 1;
+    QVector<int> sorted;
+    sorted.reserve( d->m_sorted.count() - count );
+    Q_FOREACH( int row, d->m_sorted ) {
+        if( row > last )
+            sorted.append( row - count );
+        else if( row < first )
+            sorted.append( row );
+    }
+    d->m_sorted = sorted;
+
+    for( int i = 0; i < d->m_visible.count(); ++i ) {
+        if( d->m_visible[i] > last )
+            d->m_visible[i] -= count;
+    }
+
+    d->m_entries.remove( first, count );
+    d->rebuildSourceToProxy();
+}
+
+
+void Nepomuk2::ResourceListProxyModel::slotSourceDataChanged( const QModelIndex& topLeft, const QModelIndex& bottomRight )
+{
+    if( topLeft.parent().isValid() )
+        return;
+
+    // only the rows whose sort or filter keys actually changed need to move
+    QVector<int> changedRows;
+    if( d->requiredKeys() ) {
+        for( int row = topLeft.row(); row <= bottomRight.row(); ++row ) {
+            const Private::Entry oldEntry = d->m_entries[row];
+            d->updateKeys( row, row, true );
+            const Private::Entry& entry = d->m_entries[row];
+            if( entry.label != oldEntry.label ||
+                entry.type != oldEntry.type ||
+                entry.created != oldEntry.created )
+                changedRows.append( row );
+        }
+    }
+    else {
+        d->updateKeys( topLeft.row(), bottomRight.row(), true );
+    }
+
+    if( !changedRows.isEmpty() ) {
+        d->reposition( changedRows );
+    }
+
+    for( int row = topLeft.row(); row <= bottomRight.row(); ++row ) {
+        const int proxyRow = d->m_sourceToProxy[row];
+        if( proxyRow >= 0 ) {
+            emit dataChanged( index( proxyRow, topLeft.column() ), index( proxyRow, bottomRight.column() ) );
+        }
+    }
+}
+
+
+void Nepomuk2::ResourceListProxyModel::slotSourceReset()
+{
+    d->m_entries.fill( Private::Entry(), sourceModel() ? sourceModel()->rowCount() : 0 );
+    d->sortAll();
+    d->m_visible = d->filter( d->m_sorted );
+    d->rebuildSourceToProxy();
+    reset();
+}
+
+#include "resourcelistproxymodel.moc"
@@ -0,0 +1,108 @@
+/*
+   Copyright (C) 2010 by Sebastian Trueg <trueg at kde.org>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _NEPOMUK_RESOURCE_LIST_PROXY_MODEL_H_
+#define _NEPOMUK_RESOURCE_LIST_PROXY_MODEL_H_
+
+#include <QtGui/QAbstractProxyModel>
+
+namespace Nepomuk2 {
+    /**
+     * \class ResourceListProxyModel resourcelistproxymodel.h
+     *
+     * \brief Sorts and filters a flat Utils::ResourceModel.
+     *
+     * In contrast to QSortFilterProxyModel the sorted index is updated
+     * incrementally: rows added to the source model are sorted on their own
+     * and then merged into the existing order. Sort keys and the filter text
+     * of each row are computed once and cached, so neither re-sorting nor
+     * filtering touches the resources again.
+     *
+     * The keys are only computed if needed. Without sorting and filtering the
+     * model simply forwards the source order.
+     */
+    class ResourceListProxyModel : public QAbstractProxyModel
+    {
+        Q_OBJECT
+
+    public:
+        ResourceListProxyModel( QObject* parent = 0 );
+        ~ResourceListProxyModel();
+
+        enum SortKey {
+            /// Keep the order of the source model
+            SourceOrder,
+
+            /// Sort by the resource label
+            SortByLabel,
+
+            /// Sort by the label of the resource type, then by the resource label
+            SortByType,
+
+            /// Sort by the creation date as provided by Utils::ResourceModel::ResourceCreationDateRole
+            SortByCreationDate
+        };
+
+        void setSourceModel( QAbstractItemModel* sourceModel );
+
+        SortKey sortKey() const;
+        Qt::SortOrder sortOrder() const;
+        QString filterString() const;
+
+        QModelIndex mapToSource( const QModelIndex& proxyIndex ) const;
+        QModelIndex mapFromSource( const QModelIndex& sourceIndex ) const;
+
+        QModelIndex index( int row, int column, const QModelIndex& parent = QModelIndex() ) const;
+        QModelIndex parent( const QModelIndex& index ) const;
+        int rowCount( const QModelIndex& parent = QModelIndex() ) const;
+        int columnCount( const QModelIndex& parent = QModelIndex() ) const;
+        QVariant headerData( int section, Qt::Orientation orientation, int role = Qt::DisplayRole ) const;
+        QMimeData* mimeData( const QModelIndexList& indexes ) const;
+        QStringList mimeTypes() const;
+
+        /**
+         * Reimplemented to map the resource column to SortByLabel and the
+         * type column to SortByType.
+         */
+        void sort( int column, Qt::SortOrder order = Qt::AscendingOrder );
+
+    public Q_SLOTS:
+        void setSortKey( Nepomuk2::ResourceListProxyModel::SortKey key, Qt::SortOrder order = Qt::AscendingOrder );
+
+        /**
+         * Only show resources whose label or type label contain all
+         * the words in \p filter. Matching is case-insensitive.
+         */
+        void setFilterString( const QString& filter );
+
+    private Q_SLOTS:
+        void slotSourceRowsInserted( const QModelIndex& parent, int first, int last );
+        void slotSourceRowsAboutToBeRemoved( const QModelIndex& parent, int first, int last );
+        void slotSourceRowsRemoved( const QModelIndex& parent, int first, int last );
+        void slotSourceDataChanged( const QModelIndex& topLeft, const QModelIndex& bottomRight );
+        void slotSourceReset();
+
+    private:
+        class Private;
+        Private* const d;
+    };
+}
+
+#endif
@@ -19,6 +19,7 @@
  */
 
 #include "resourcepropertymodel.h"
+#include "graphmetadatacache.h"
 
 #include <nepomuk2/resource.h>
 #include <nepomuk2/resourcemanager.h>
@@ -27,83 +28,669 @@
 #include <nepomuk2/variant.h>
 #include <nepomuk2/literal.h>
 #include <nepomuk2/nie.h>
+#include <nepomuk2/nco.h>
+#include <nepomuk2/nfo.h>
 
 #include <KDebug>
+#include <KIcon>
 
 #include <QtGui/QFont>
+#include <QtGui/QTextDocument>
 #include <QtGui/QIcon>
 #include <QtCore/QPair>
 #include <QtCore/QList>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QTimer>
 
 #include <Soprano/Statement>
 #include <Soprano/Node>
 #include <Soprano/LiteralValue>
 #include <Soprano/Model>
 #include <Soprano/Vocabulary/NAO>
+#include <Soprano/Vocabulary/RDF>
+#include <Soprano/Vocabulary/RDFS>
 #include <Soprano/QueryResultIterator>
+#include <Soprano/Util/AsyncQuery>
 
 
 Q_DECLARE_METATYPE( Nepomuk2::Types::Property )
 Q_DECLARE_METATYPE( Nepomuk2::Variant )
 
 
+namespace {
+/// The number of rows fetched before the first page is shown
+const int s_firstPageSize = 100;
+
+/// The number of rows fetched with each fetchMore()
+const int s_pageSize = 500;
+
+/// Only this many characters of long literals are loaded with the statements
+const int s_literalPrefixLength = 50;
+
+/// The minimum time in msecs between two updates triggered by change notifications
+const int s_updateDelay = 1000;
+
+/// Identifies a statement the way it is loaded, i.e. with long literals truncated
+QString statementKey( const Soprano::Statement& s )
+{
+    Soprano::Node object = s.object();
+    if( object.isLiteral() && object.literal().isString() && object.literal().toString().length() > s_literalPrefixLength )
+        object = Soprano::LiteralValue( object.literal().toString().left( s_literalPrefixLength ) );
+    return s.subject().toN3() + s.predicate().toN3() + object.toN3() + s.context().toN3();
+}
+
+/// The properties used as resource labels, in order of preference
+QList<QUrl> labelProperties()
+{
+    return QList<QUrl>() << Soprano::Vocabulary::NAO::prefLabel()
+                         << Soprano::Vocabulary::RDFS::label()
+                         << Nepomuk2::Vocabulary::NIE::title()
+                         << Nepomuk2::Vocabulary::NCO::fullname()
+                         << Nepomuk2::Vocabulary::NFO::fileName();
+}
+}
+
+
 class Nepomuk2::ResourcePropertyEditModel::Private
 {
 public:
+    Private( ResourcePropertyEditModel* parent )
+        : m_query( 0 ),
+          m_countQuery( 0 ),
+          m_pageSize( 0 ),
+          m_hasMore( false ),
+          m_totalCount( -1 ),
+          m_countFailed( false ),
+          m_complete( false ),
+          m_resourceInfoQuery( 0 ),
+          m_fullValueQuery( 0 ),
+          m_updateQuery( 0 ),
+          q( parent ) {
+    }
+
+    /// The display information of a resource-valued row
+    struct ResourceInfo {
+        ResourceInfo() : labelRank( -1 ) {}
+        QString label;
+        int labelRank;
+        QString iconName;
+        QList<QUrl> types;
+    };
+
     Resource m_resource;
     ResourcePropertyEditModel::Mode m_mode;
 
-    QList<QPair<Soprano::Statement, QDateTime> > m_properties;
+    StatementList m_properties;
+
+    /// the rows fetched but not yet inserted into the model
+    StatementList m_pendingProperties;
+
+    Soprano::Util::AsyncQuery* m_query;
+    Soprano::Util::AsyncQuery* m_countQuery;
+
+    /// the number of rows requested with the running page query
+    int m_pageSize;
+
+    /// true if there are more rows than loaded, we wait for fetchMore()
+    bool m_hasMore;
+
+    int m_totalCount;
+
+    /// true if counting failed, we do not try again for the same resource
+    bool m_countFailed;
+
+    /// true if all statements have been loaded
+    bool m_complete;
+
+    /// labels, icons, and types of the resources shown in the value column
+    QHash<QUrl, ResourceInfo> m_resourceInfo;
+    QSet<QUrl> m_unresolvedResources;
+    Soprano::Util::AsyncQuery* m_resourceInfoQuery;
+
+    /// loads the complete value of a long literal before it is edited
+    Soprano::Util::AsyncQuery* m_fullValueQuery;
+    QPersistentModelIndex m_fullValueIndex;
+
+    /// live updates: the predicates changed since the last update
+    QTimer m_updateTimer;
+    QSet<QUrl> m_changedPredicates;
+    QSet<QUrl> m_updatePredicates;
+    StatementList m_updateResults;
+    Soprano::Util::AsyncQuery* m_updateQuery;
+
+    /// Predicates whose statements have been loaded completely by an update before all pages
+    /// were loaded. The pages skip them, otherwise their rows would show up twice.
+    QSet<QUrl> m_updatedPredicates;
 
     void rebuild();
+    void startPageQuery( int pageSize );
+    void pageLoaded();
+    QString statementQuery( const QSet<QUrl>& predicates = QSet<QUrl>(),
+                            const QSet<QUrl>& excludedPredicates = QSet<QUrl>() ) const;
+    void startUpdateQuery();
+    void applyUpdate();
+    void startCountQuery();
+    void closeQueries();
+    void flushPendingProperties();
+    void addUnresolvedResources( const StatementList& properties );
+    void startResourceInfoQuery();
+    void loadGraphMetadata( const StatementList& properties );
+    QString resourceLabel( const QUrl& uri ) const;
+    QIcon resourceIcon( const QUrl& uri ) const;
+    void setTotalCount( int count );
+    StatementInfo propertyFromQuery( Soprano::Util::AsyncQuery* query ) const;
+
+    /// the value of \p row as shown, long literals are cut off
+    QString displayText( int row ) const;
+
+    /// the query for the complete object of a row whose literal was loaded partially
+    QString fullValueQuery( int row ) const;
+
+    /// The statements of \p rows including the complete literal values. The values which have
+    /// not been loaded yet are resolved with one blocking query. \return false if one of them
+    /// cannot be found anymore.
+    bool fullStatements( const QList<int>& rows, QList<Soprano::Statement>* statements ) const;
+
+private:
+    ResourcePropertyEditModel* q;
 };
 
 
 void Nepomuk2::ResourcePropertyEditModel::Private::rebuild()
 {
+    closeQueries();
     m_properties.clear();
+    m_resourceInfo.clear();
+    m_complete = false;
+    m_countFailed = false;
+    m_updatedPredicates.clear();
+    setTotalCount( -1 );
+
+    if ( !m_resource.isValid() )
+        return;
+
+    // The results are loaded one page at a time, the next one only once the view asks
+    // for it via fetchMore(). Thus, popular resources with lots of backlinks do not
+    // block anything and only cost what is shown.
+    startPageQuery( s_firstPageSize );
+}
 
-    // we get all statements + their creation date
-    QString query;
+
+void Nepomuk2::ResourcePropertyEditModel::Private::startPageQuery( int pageSize )
+{
+    // Each page is a query of its own which is closed as soon as the page is complete.
+    // An open cursor would keep server resources for as long as the view is shown.
+    // One row more than needed tells if there is another page.
+    m_pageSize = pageSize;
+    m_hasMore = false;
+
+    // the rows of updated predicates are not part of the pages anymore
+    int offset = 0;
+    for( int i = 0; i < m_properties.count(); ++i ) {
+        if( !m_updatedPredicates.contains( m_properties[i].statement.predicate().uri() ) )
+            ++offset;
+    }
+
+    const QString order = ( m_mode == ResourcePropertyEditModel::PropertiesMode
+                            ? QLatin1String( "?p ?g ?v" )
+                            : QLatin1String( "?p ?s ?g" ) );
+    const QString query = statementQuery( QSet<QUrl>(), m_updatedPredicates )
+                          + QString::fromLatin1( " ORDER BY %1 LIMIT %2 OFFSET %3" )
+                          .arg( order,
+                                QString::number( pageSize + 1 ),
+                                QString::number( offset ) );
+
+    m_query = Soprano::Util::AsyncQuery::executeQuery( ResourceManager::instance()->mainModel(),
+                                                       query,
+                                                       Soprano::Query::QueryLanguageSparql );
+    q->connect( m_query, SIGNAL(nextReady(Soprano::Util::AsyncQuery*)),
+                SLOT(slotNextResultReady(Soprano::Util::AsyncQuery*)) );
+    q->connect( m_query, SIGNAL(finished(Soprano::Util::AsyncQuery*)),
+                SLOT(slotQueryFinished(Soprano::Util::AsyncQuery*)) );
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::Private::pageLoaded()
+{
+    flushPendingProperties();
+
+    if( m_hasMore ) {
+        if( m_totalCount < 0 && !m_countQuery && !m_countFailed )
+            startCountQuery();
+    }
+    else {
+        // no need to wait for the count query anymore
+        if( m_countQuery ) {
+            m_countQuery->close();
+            m_countQuery->disconnect( q );
+            m_countQuery = 0;
+        }
+        m_complete = true;
+        setTotalCount( m_properties.count() );
+    }
+
+    // changes which came in while the page was loading
+    if( !m_changedPredicates.isEmpty() && !m_updateTimer.isActive() )
+        m_updateTimer.start();
+}
+
+
+QString Nepomuk2::ResourcePropertyEditModel::Private::statementQuery( const QSet<QUrl>& predicates,
+                                                                      const QSet<QUrl>& excludedPredicates ) const
+{
+    QString filter;
+    if( !predicates.isEmpty() ) {
+        QStringList predicateNodes;
+        Q_FOREACH( const QUrl& predicate, predicates ) {
+            predicateNodes << Soprano::Node::resourceToN3( predicate );
+        }
+        filter = QString::fromLatin1("FILTER(?p in (%1)) . ").arg( predicateNodes.join( QLatin1String( "," ) ) );
+    }
+    if( !excludedPredicates.isEmpty() ) {
+        QStringList predicateNodes;
+        Q_FOREACH( const QUrl& predicate, excludedPredicates ) {
+            predicateNodes << Soprano::Node::resourceToN3( predicate );
+        }
+        filter += QString::fromLatin1("FILTER(!(?p in (%1))) . ").arg( predicateNodes.join( QLatin1String( "," ) ) );
+    }
+
+    // we get all statements, their creation dates are resolved through the GraphMetadataCache
     if ( m_mode == ResourcePropertyEditModel::PropertiesMode ) {
-        query = QString::fromLatin1("select ?p ?o ?g ?d where { graph ?g { %1 ?p ?o } . OPTIONAL { ?g %2 ?d . } }")
+        // Long literals like nie:plainTextContent can be huge. We only transfer a prefix and the
+        // full length, the complete value is loaded on demand via loadFullValue().
+        return QString::fromLatin1("select ?p ?g "
+                                   "(if(isLiteral(?v) && strlen(str(?v)) > %2, substr(str(?v), 1, %2), ?v) as ?o) "
+                                   "(if(isLiteral(?v), strlen(str(?v)), 0) as ?l) "
+                                   "where { graph ?g { %1 ?p ?v } . %3}")
                 .arg(Soprano::Node::resourceToN3(m_resource.uri()),
-                     Soprano::Node::resourceToN3(Soprano::Vocabulary::NAO::created()));
+                     QString::number(s_literalPrefixLength),
+                     filter);
     }
     else {
-        query = QString::fromLatin1("select ?s ?p ?g ?d where { graph ?g { ?s ?p %1 } . OPTIONAL { ?g %2 ?d . } }")
+        return QString::fromLatin1("select ?s ?p ?g where { graph ?g { ?s ?p %1 } . %2}")
                 .arg(Soprano::Node::resourceToN3(m_resource.uri()),
-                     Soprano::Node::resourceToN3(Soprano::Vocabulary::NAO::created()));
-    }
-
-    Soprano::QueryResultIterator it = ResourceManager::instance()->mainModel()->executeQuery( query, Soprano::Query::QueryLanguageSparql );
-    while( it.next() ) {
-        Soprano::Statement s;
-        if ( m_mode == ResourcePropertyEditModel::PropertiesMode )
-            s = Soprano::Statement( m_resource.uri(), it[QLatin1String("p")], it[QLatin1String("o")], it[QLatin1String("g")] );
-        else
-            s = Soprano::Statement( it[QLatin1String("s")], it[QLatin1String("p")], m_resource.uri(), it[QLatin1String("g")] );
-        
-        // Make sure the string is not too long
-        if( s.object().literal().isString() ) {
-            QString string = s.object().literal().variant().toString().mid(0, 50);
-            s.setObject( Soprano::LiteralValue( string ) );
+                     filter);
+    }
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::Private::startUpdateQuery()
+{
+    // Changes are applied as a diff to the loaded statements. Pages and updates never
+    // run at the same time, otherwise a page could contain rows of an updated predicate.
+    if( m_changedPredicates.isEmpty() || m_updateQuery || m_query )
+        return;
+
+    m_updatePredicates = m_changedPredicates;
+    m_changedPredicates.clear();
+    m_updateResults.clear();
+
+    m_updateQuery = Soprano::Util::AsyncQuery::executeQuery( ResourceManager::instance()->mainModel(),
+                                                             statementQuery( m_updatePredicates ),
+                                                             Soprano::Query::QueryLanguageSparql );
+    q->connect( m_updateQuery, SIGNAL(nextReady(Soprano::Util::AsyncQuery*)),
+                SLOT(slotUpdateResultReady(Soprano::Util::AsyncQuery*)) );
+    q->connect( m_updateQuery, SIGNAL(finished(Soprano::Util::AsyncQuery*)),
+                SLOT(slotUpdateQueryFinished(Soprano::Util::AsyncQuery*)) );
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::Private::applyUpdate()
+{
+    QSet<QString> newKeys;
+    for( int i = 0; i < m_updateResults.count(); ++i ) {
+        newKeys.insert( statementKey( m_updateResults[i].statement ) );
+    }
+
+    // find the removed rows and the rows we already have
+    QList<int> removedRows;
+    QSet<QString> oldKeys;
+    for( int i = 0; i < m_properties.count(); ++i ) {
+        const Soprano::Statement& s = m_properties[i].statement;
+        if( m_updatePredicates.contains( s.predicate().uri() ) ) {
+            const QString key = statementKey( s );
+            if( newKeys.contains( key ) )
+                oldKeys.insert( key );
+            else
+                removedRows.append( i );
+        }
+    }
+
+    StatementList addedProperties;
+    for( int i = 0; i < m_updateResults.count(); ++i ) {
+        if( !oldKeys.contains( statementKey( m_updateResults[i].statement ) ) )
+            addedProperties.append( m_updateResults[i] );
+    }
+    m_updateResults.clear();
+
+    // remove from the bottom up so the remaining row numbers stay valid
+    int i = removedRows.count() - 1;
+    while( i >= 0 ) {
+        const int last = removedRows[i];
+        int first = last;
+        while( i > 0 && removedRows[i-1] == first-1 ) {
+            --i;
+            --first;
         }
-        m_properties.append( qMakePair( s, it[QLatin1String("d")].literal().toDateTime() ) );
+        q->beginRemoveRows( QModelIndex(), first, last );
+        m_properties.erase( m_properties.begin() + first, m_properties.begin() + last + 1 );
+        q->endRemoveRows();
+        --i;
+    }
+
+    m_pendingProperties = addedProperties;
+    flushPendingProperties();
+
+    // In a partially loaded table the changed predicates are now loaded completely,
+    // no matter if the pages had reached them yet.
+    if( m_complete ) {
+        setTotalCount( m_properties.count() );
+    }
+    else {
+        m_updatedPredicates += m_updatePredicates;
+        if( m_totalCount >= 0 )
+            setTotalCount( m_totalCount + addedProperties.count() - removedRows.count() );
     }
 }
 
 
+void Nepomuk2::ResourcePropertyEditModel::Private::startCountQuery()
+{
+    // Only needed if the statements do not fit into the first page. Most resources
+    // are small and we do not want the count to compete with the property and
+    // backlink queries which run at the same time.
+    QString query;
+    if ( m_mode == ResourcePropertyEditModel::PropertiesMode ) {
+        query = QString::fromLatin1("select (count(*) as ?c) where { graph ?g { %1 ?p ?o } . }")
+                .arg(Soprano::Node::resourceToN3(m_resource.uri()));
+    }
+    else {
+        query = QString::fromLatin1("select (count(*) as ?c) where { graph ?g { ?s ?p %1 } . }")
+                .arg(Soprano::Node::resourceToN3(m_resource.uri()));
+    }
+
+    m_countQuery = Soprano::Util::AsyncQuery::executeQuery( ResourceManager::instance()->mainModel(),
+                                                            query,
+                                                            Soprano::Query::QueryLanguageSparql );
+    q->connect( m_countQuery, SIGNAL(nextReady(Soprano::Util::AsyncQuery*)),
+                SLOT(slotCountResultReady(Soprano::Util::AsyncQuery*)) );
+    q->connect( m_countQuery, SIGNAL(finished(Soprano::Util::AsyncQuery*)),
+                SLOT(slotCountQueryFinished(Soprano::Util::AsyncQuery*)) );
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::Private::closeQueries()
+{
+    if( m_query ) {
+        m_query->close();
+        m_query->disconnect( q );
+        m_query = 0;
+    }
+    if( m_countQuery ) {
+        m_countQuery->close();
+        m_countQuery->disconnect( q );
+        m_countQuery = 0;
+    }
+    if( m_resourceInfoQuery ) {
+        m_resourceInfoQuery->close();
+        m_resourceInfoQuery->disconnect( q );
+        m_resourceInfoQuery = 0;
+    }
+    if( m_updateQuery ) {
+        m_updateQuery->close();
+        m_updateQuery->disconnect( q );
+        m_updateQuery = 0;
+    }
+    if( m_fullValueQuery ) {
+        m_fullValueQuery->close();
+        m_fullValueQuery->disconnect( q );
+        m_fullValueQuery = 0;
+    }
+    m_updateTimer.stop();
+    m_changedPredicates.clear();
+    m_pendingProperties.clear();
+    m_unresolvedResources.clear();
+    m_hasMore = false;
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::Private::flushPendingProperties()
+{
+    if( !m_pendingProperties.isEmpty() ) {
+        addUnresolvedResources( m_pendingProperties );
+        loadGraphMetadata( m_pendingProperties );
+        q->beginInsertRows( QModelIndex(), m_properties.count(), m_properties.count() + m_pendingProperties.count() - 1 );
+        m_properties << m_pendingProperties;
+        m_pendingProperties.clear();
+        q->endInsertRows();
+    }
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::Private::addUnresolvedResources( const StatementList& properties )
+{
+    for( int i = 0; i < properties.count(); ++i ) {
+        const Soprano::Node node = ( m_mode == ResourcePropertyEditModel::PropertiesMode
+                                     ? properties[i].statement.object()
+                                     : properties[i].statement.subject() );
+        if( node.isResource() && !m_resourceInfo.contains( node.uri() ) )
+            m_unresolvedResources.insert( node.uri() );
+    }
+
+    if( !m_resourceInfoQuery )
+        startResourceInfoQuery();
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::Private::loadGraphMetadata( const StatementList& properties )
+{
+    QSet<QUrl> graphs;
+    for( int i = 0; i < properties.count(); ++i ) {
+        if( !properties[i].creationDate.isValid() )
+            graphs.insert( properties[i].statement.context().uri() );
+    }
+    if( !graphs.isEmpty() )
+        GraphMetadataCache::self()->load( graphs.toList() );
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::Private::startResourceInfoQuery()
+{
+    if( m_unresolvedResources.isEmpty() )
+        return;
+
+    // One query for all the resources of a page instead of one Resource per row and repaint.
+    // The result is combined just like Resource::genericLabel() and Resource::genericIcon() do.
+    QStringList resources;
+    Q_FOREACH( const QUrl& uri, m_unresolvedResources ) {
+        resources << Soprano::Node::resourceToN3( uri );
+        m_resourceInfo.insert( uri, ResourceInfo() );
+    }
+    m_unresolvedResources.clear();
+
+    QStringList properties;
+    properties << Soprano::Node::resourceToN3( Soprano::Vocabulary::RDF::type() )
+               << Soprano::Node::resourceToN3( Soprano::Vocabulary::NAO::hasSymbol() );
+    Q_FOREACH( const QUrl& property, labelProperties() ) {
+        properties << Soprano::Node::resourceToN3( property );
+    }
+
+    const QString query = QString::fromLatin1("select ?r ?p ?v where { ?r ?p ?v . FILTER(?r in (%1)) . FILTER(?p in (%2)) . }")
+                          .arg( resources.join( QLatin1String( "," ) ),
+                                properties.join( QLatin1String( "," ) ) );
+
+    m_resourceInfoQuery = Soprano::Util::AsyncQuery::executeQuery( ResourceManager::instance()->mainModel(),
+                                                                   query,
+                                                                   Soprano::Query::QueryLanguageSparql );
+    q->connect( m_resourceInfoQuery, SIGNAL(nextReady(Soprano::Util::AsyncQuery*)),
+                SLOT(slotResourceInfoResultReady(Soprano::Util::AsyncQuery*)) );
+    q->connect( m_resourceInfoQuery, SIGNAL(finished(Soprano::Util::AsyncQuery*)),
+                SLOT(slotResourceInfoQueryFinished(Soprano::Util::AsyncQuery*)) );
+}
+
+
+QString Nepomuk2::ResourcePropertyEditModel::Private::resourceLabel( const QUrl& uri ) const
+{
+    QHash<QUrl, ResourceInfo>::const_iterator it = m_resourceInfo.constFind( uri );
+    if( it != m_resourceInfo.constEnd() && !it->label.isEmpty() )
+        return it->label;
+    else
+        return KUrl( uri ).prettyUrl();
+}
+
+
+QIcon Nepomuk2::ResourcePropertyEditModel::Private::resourceIcon( const QUrl& uri ) const
+{
+    QHash<QUrl, ResourceInfo>::const_iterator it = m_resourceInfo.constFind( uri );
+    if( it != m_resourceInfo.constEnd() ) {
+        if( !it->iconName.isEmpty() )
+            return KIcon( it->iconName );
+
+        // fallback: try to get a symbol from the type
+        Q_FOREACH( const QUrl& type, it->types ) {
+            const QIcon icon = Types::Class( type ).icon();
+            if( !icon.isNull() )
+                return icon;
+        }
+    }
+    return QIcon();
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::Private::setTotalCount( int count )
+{
+    if( m_totalCount != count ) {
+        m_totalCount = count;
+        emit q->totalCountChanged( count );
+    }
+}
+
+
+Nepomuk2::ResourcePropertyEditModel::StatementInfo Nepomuk2::ResourcePropertyEditModel::Private::propertyFromQuery( Soprano::Util::AsyncQuery* query ) const
+{
+    StatementInfo info;
+    if ( m_mode == ResourcePropertyEditModel::PropertiesMode ) {
+        info.statement = Soprano::Statement( m_resource.uri(), query->binding(QLatin1String("p")), query->binding(QLatin1String("o")), query->binding(QLatin1String("g")) );
+        const int length = query->binding(QLatin1String("l")).literal().toInt();
+        if( length > s_literalPrefixLength )
+            info.fullLength = length;
+    }
+    else {
+        info.statement = Soprano::Statement( query->binding(QLatin1String("s")), query->binding(QLatin1String("p")), m_resource.uri(), query->binding(QLatin1String("g")) );
+    }
+    info.creationDate = GraphMetadataCache::self()->creationDate( info.statement.context().uri() );
+    return info;
+}
+
+
+QString Nepomuk2::ResourcePropertyEditModel::Private::displayText( int row ) const
+{
+    // even completely loaded values are cut off, the table cannot show megabytes of text
+    const QString text = m_properties[row].statement.object().literal().toString();
+    if( m_properties[row].fullLength >= 0 || text.length() > s_literalPrefixLength )
+        return text.left( s_literalPrefixLength ) + QChar( 0x2026 );
+    else
+        return text;
+}
+
+
+QString Nepomuk2::ResourcePropertyEditModel::Private::fullValueQuery( int row ) const
+{
+    // The prefix is compared as a plain string, the literal it was cut from may have any type.
+    const StatementInfo& info = m_properties[row];
+    return QString::fromLatin1("select ?o where { graph %1 { %2 %3 ?o } . "
+                               "FILTER(isLiteral(?o) && strlen(str(?o)) = %4 && str(substr(str(?o), 1, %5)) = %6) . } LIMIT 1")
+            .arg( Soprano::Node::resourceToN3( info.statement.context().uri() ),
+                  Soprano::Node::resourceToN3( info.statement.subject().uri() ),
+                  Soprano::Node::resourceToN3( info.statement.predicate().uri() ),
+                  QString::number( info.fullLength ),
+                  QString::number( s_literalPrefixLength ),
+                  Soprano::Node::literalToN3( Soprano::LiteralValue::createPlainLiteral( info.statement.object().literal().toString() ) ) );
+}
+
+
+bool Nepomuk2::ResourcePropertyEditModel::Private::fullStatements( const QList<int>& rows, QList<Soprano::Statement>* statements ) const
+{
+    // the partially loaded rows are matched like in fullValueQuery(), but all of them at once
+    QList<int> partialRows;
+    QStringList conditions;
+    Q_FOREACH( int row, rows ) {
+        const StatementInfo& info = m_properties[row];
+        if( info.fullLength < 0 )
+            continue;
+        partialRows << row;
+        conditions << QString::fromLatin1("(?p = %1 && ?g = %2 && strlen(str(?o)) = %3 && str(substr(str(?o), 1, %4)) = %5)")
+                      .arg( Soprano::Node::resourceToN3( info.statement.predicate().uri() ),
+                            Soprano::Node::resourceToN3( info.statement.context().uri() ),
+                            QString::number( info.fullLength ),
+                            QString::number( s_literalPrefixLength ),
+                            Soprano::Node::literalToN3( Soprano::LiteralValue::createPlainLiteral( info.statement.object().literal().toString() ) ) );
+    }
+
+    // Only used for explicit user actions like removing statements, never while painting.
+    QHash<int, Soprano::Node> fullValues;
+    if( !partialRows.isEmpty() ) {
+        const QString query = QString::fromLatin1("select ?p ?g ?o where { graph ?g { %1 ?p ?o } . "
+                                                  "FILTER(isLiteral(?o) && (%2)) . }")
+                              .arg( Soprano::Node::resourceToN3( m_resource.uri() ),
+                                    conditions.join( QLatin1String( " || " ) ) );
+        Soprano::QueryResultIterator it = ResourceManager::instance()->mainModel()->executeQuery( query, Soprano::Query::QueryLanguageSparql );
+        while( it.next() ) {
+            const QUrl predicate = it[QLatin1String("p")].uri();
+            const QUrl graph = it[QLatin1String("g")].uri();
+            const Soprano::Node value = it[QLatin1String("o")];
+            const QString text = value.literal().toString();
+            // rows with the same beginning get one value each
+            Q_FOREACH( int row, partialRows ) {
+                const Soprano::Statement& statement = m_properties[row].statement;
+                if( !fullValues.contains( row ) &&
+                    statement.predicate().uri() == predicate &&
+                    statement.context().uri() == graph &&
+                    text.startsWith( statement.object().literal().toString() ) ) {
+                    fullValues.insert( row, value );
+                    break;
+                }
+            }
+        }
+        it.close();
+
+        if( fullValues.count() < partialRows.count() ) {
+            kDebug() << "Could not find the complete values of" << ( partialRows.count() - fullValues.count() ) << "statements";
+            return false;
+        }
+    }
+
+    Q_FOREACH( int row, rows ) {
+        Soprano::Statement statement( m_properties[row].statement );
+        if( fullValues.contains( row ) )
+            statement.setObject( fullValues[row] );
+        *statements << statement;
+    }
+    return true;
+}
+
+
 Nepomuk2::ResourcePropertyEditModel::ResourcePropertyEditModel( QObject* parent )
     : QAbstractTableModel( parent ),
-      d( new Private() )
+      d( new Private( this ) )
 {
     d->m_mode = PropertiesMode;
+
+    connect( GraphMetadataCache::self(), SIGNAL(graphsLoaded(QList<QUrl>)),
+             this, SLOT(slotGraphsLoaded(QList<QUrl>)) );
+
+    // bulk indexing can change a resource many times a second, we only update once in a while
+    d->m_updateTimer.setSingleShot( true );
+    d->m_updateTimer.setInterval( s_updateDelay );
+    connect( &d->m_updateTimer, SIGNAL(timeout()),
+             this, SLOT(slotUpdate()) );
 }
 
 
 Nepomuk2::ResourcePropertyEditModel::~ResourcePropertyEditModel()
 {
+    d->closeQueries();
     delete d;
 }
 
@@ -138,6 +725,25 @@ void Nepomuk2::ResourcePropertyEditModel::setResource( const Nepomuk2::Resource&
 }
 
 
+void Nepomuk2::ResourcePropertyEditModel::setResource( const Nepomuk2::Resource& resource, const StatementList& statements, bool complete )
+{
+    d->closeQueries();
+    d->m_resource = resource;
+    d->m_properties = statements;
+    d->m_resourceInfo.clear();
+    d->addUnresolvedResources( statements );
+    d->loadGraphMetadata( statements );
+    d->m_updatedPredicates.clear();
+    d->m_countFailed = false;
+    d->m_complete = complete;
+
+    // paging simply continues after the restored rows
+    d->m_hasMore = !complete;
+    d->setTotalCount( complete ? statements.count() : -1 );
+    reset();
+}
+
+
 int Nepomuk2::ResourcePropertyEditModel::columnCount( const QModelIndex& ) const
 {
     return 3;
@@ -154,9 +760,9 @@ int Nepomuk2::ResourcePropertyEditModel::rowCount( const QModelIndex& index ) co
 QVariant Nepomuk2::ResourcePropertyEditModel::data( const QModelIndex& index, int role ) const
 {
     if ( index.isValid() && index.row() < d->m_properties.count() ) {
-        const Nepomuk2::Types::Property property = d->m_properties[index.row()].first.predicate().uri();
+        const Nepomuk2::Types::Property property = d->m_properties[index.row()].statement.predicate().uri();
         const Soprano::Node value = nodeForIndex( index );
-        const QDateTime date = d->m_properties[index.row()].second;
+        const QDateTime date = d->m_properties[index.row()].creationDate;
 
         if( role == PropertyRole ) {
             return QVariant::fromValue( property );
@@ -179,18 +785,20 @@ QVariant Nepomuk2::ResourcePropertyEditModel::data( const QModelIndex& index, in
             switch( role ) {
             case Qt::DisplayRole:
                 if( value.isResource() ) {
-                    Resource res = Resource::fromResourceUri( value.uri() );
                     if ( property == Nepomuk2::Vocabulary::NIE::url() ) {
                         return KUrl( value.uri() ).prettyUrl();
                     }
                     else {
-                        return res.genericLabel();
+                        return d->resourceLabel( value.uri() );
                     }
                 }
+                else if( value.literal().isString() )
+                    return d->displayText( index.row() );
                 else
                     return value.literal().variant();
 
             case Qt::EditRole:
+                // long literals are only editable once loadFullValue() is done
                 if( value.isResource() )
                     return QVariant::fromValue(Nepomuk2::Resource(value.uri()));
                 else
@@ -198,27 +806,52 @@ QVariant Nepomuk2::ResourcePropertyEditModel::data( const QModelIndex& index, in
 
             case Qt::DecorationRole:
                 if( value.isResource() )
-                    return Nepomuk2::Resource(value.uri()).genericIcon();
+                    return d->resourceIcon( value.uri() );
                 break;
 
             case Qt::ToolTipRole:
-                return value.toString();
+                if( value.isLiteral() && value.literal().isString() ) {
+                    const QString text = d->displayText( index.row() );
+                    if( text.length() > s_literalPrefixLength ) {
+                        const int length = qMax( d->m_properties[index.row()].fullLength, value.literal().toString().length() );
+                        return i18ncp( "@info:tooltip %2 is the beginning of a long text",
+                                       "%2<br><i>(1 character)</i>",
+                                       "%2<br><i>(%1 characters)</i>",
+                                       length,
+                                       Qt::escape( text ) );
+                    }
+                    return text;
+                }
+                else {
+                    return value.toString();
+                }
             }
 
-        case 2:
-            if( role == Qt::DisplayRole ) {
+        case 2: {
+            const QUrl graph = d->m_properties[index.row()].statement.context().uri();
+            if( !date.isValid() && !GraphMetadataCache::self()->contains( graph ) ) {
+                // still loading
+                return QVariant();
+            }
+            else if( role == Qt::DisplayRole ) {
                 if( date.isValid() )
                     return date;
                 else
                     return i18nc("@item refers to an unknown date", "Unknown");
             }
             else if( role == Qt::ToolTipRole ) {
-                if( date.isValid() )
-                    return Soprano::LiteralValue( date ).toString();
-                else
+                if( !date.isValid() )
                     return i18n("An invalid creation date means invalid Nepomuk data!");
+                else if( !GraphMetadataCache::self()->agent( graph ).isEmpty() )
+                    return i18nc("@info:tooltip %1 is a date, %2 the name of an application",
+                                 "%1 by %2",
+                                 Soprano::LiteralValue( date ).toString(),
+                                 GraphMetadataCache::self()->agent( graph ) );
+                else
+                    return Soprano::LiteralValue( date ).toString();
             }
         }
+        }
     }
 
     return QVariant();
@@ -246,28 +879,69 @@ QVariant Nepomuk2::ResourcePropertyEditModel::headerData( int section, Qt::Orien
 bool Nepomuk2::ResourcePropertyEditModel::removeRows( int row, int count, const QModelIndex& parent )
 {
     kDebug() << row << count;
-    if( !parent.isValid() && row+count <= d->m_properties.count() ) {
+    if( !parent.isValid() && row >= 0 && count > 0 && row+count <= d->m_properties.count() ) {
+        QModelIndexList indexes;
         for( int i = row; i < row+count; ++i ) {
-            kDebug() << "Deleting row" << row;
-            // we do NOT use i since we are removing the row
-            Soprano::Statement statement = d->m_properties[row].first;
-            ResourceManager::instance()->mainModel()->removeStatement( statement );
-            d->m_properties.removeAt( row );
+            indexes << index( i, 0 );
         }
-        return true;
+        return removeStatements( indexes );
     }
 
     return false;
 }
 
 
+bool Nepomuk2::ResourcePropertyEditModel::removeStatements( const QModelIndexList& indexes )
+{
+    QSet<int> rowSet;
+    Q_FOREACH( const QModelIndex& index, indexes ) {
+        if( index.isValid() && index.model() == this )
+            rowSet.insert( index.row() );
+    }
+    if( rowSet.isEmpty() )
+        return false;
+    QList<int> rows = rowSet.toList();
+    qSort( rows );
+
+    // One store call for all of them. Removing a truncated literal would succeed
+    // without removing anything, thus, we rather remove nothing.
+    QList<Soprano::Statement> statements;
+    if( !d->fullStatements( rows, &statements ) )
+        return false;
+    if( ResourceManager::instance()->mainModel()->removeStatements( statements ) != Soprano::Error::ErrorNone ) {
+        kDebug() << ResourceManager::instance()->mainModel()->lastError();
+        return false;
+    }
+
+    // remove from the bottom up so the remaining row numbers stay valid
+    int i = rows.count() - 1;
+    while( i >= 0 ) {
+        const int last = rows[i];
+        int first = last;
+        while( i > 0 && rows[i-1] == first-1 ) {
+            --i;
+            --first;
+        }
+        beginRemoveRows( QModelIndex(), first, last );
+        d->m_properties.erase( d->m_properties.begin() + first, d->m_properties.begin() + last + 1 );
+        endRemoveRows();
+        --i;
+    }
+
+    if( d->m_totalCount >= 0 )
+        d->setTotalCount( d->m_totalCount - rows.count() );
+
+    return true;
+}
+
+
 bool Nepomuk2::ResourcePropertyEditModel::setData( const QModelIndex& index, const QVariant& value, int role )
 {
     kDebug() << index << value << role;
 
     if ( d->m_resource.isValid() ) {
         if ( index.isValid() ) {
-            const Nepomuk2::Types::Property property = d->m_properties[index.row()].first.predicate().uri();
+            const Nepomuk2::Types::Property property = d->m_properties[index.row()].statement.predicate().uri();
             Soprano::Node newObjectNode;
             if( property.range().isValid() ) {
                 newObjectNode = value.toUrl();
@@ -276,12 +950,30 @@ bool Nepomuk2::ResourcePropertyEditModel::setData( const QModelIndex& index, con
                 newObjectNode = Soprano::LiteralValue( value );
             }
 
-            if( newObjectNode.isValid() ) {
-                Soprano::Statement statement = d->m_properties[index.row()].first;
-                ResourceManager::instance()->mainModel()->removeStatement( statement );
+            // we cannot replace a value we do not know completely
+            if( newObjectNode.isValid() && d->m_properties[index.row()].fullLength < 0 ) {
+                Soprano::Model* model = ResourceManager::instance()->mainModel();
+                const Soprano::Statement oldStatement = d->m_properties[index.row()].statement;
+                if( model->removeStatement( oldStatement ) != Soprano::Error::ErrorNone ) {
+                    kDebug() << model->lastError();
+                    return false;
+                }
+
+                Soprano::Statement statement( oldStatement );
                 statement.setObject( newObjectNode );
-                ResourceManager::instance()->mainModel()->addStatement( statement );
-                d->rebuild();
+                if( model->addStatement( statement ) != Soprano::Error::ErrorNone ) {
+                    kDebug() << model->lastError();
+                    // a failed edit must not lose the old value
+                    if( model->addStatement( oldStatement ) != Soprano::Error::ErrorNone )
+                        kDebug() << "Failed to restore" << oldStatement << model->lastError();
+                    return false;
+                }
+
+                // The statement stays in its graph, thus, the creation date does not
+                // change either. No need to re-query everything for one changed row.
+                d->m_properties[index.row()].statement = statement;
+                d->m_properties[index.row()].fullLength = -1;
+                d->addUnresolvedResources( d->m_properties.mid( index.row(), 1 ) );
                 emit dataChanged( index, index );
                 return true;
             }
@@ -298,14 +990,14 @@ Soprano::Node Nepomuk2::ResourcePropertyEditModel::nodeForIndex( const QModelInd
         index.row() < d->m_properties.count() ) {
         switch( index.column() ) {
         case 0:
-            return d->m_properties[index.row()].first.predicate();
+            return d->m_properties[index.row()].statement.predicate();
         case 1:
             if ( d->m_mode == PropertiesMode )
-                return d->m_properties[index.row()].first.object();
+                return d->m_properties[index.row()].statement.object();
             else
-                return d->m_properties[index.row()].first.subject();
+                return d->m_properties[index.row()].statement.subject();
         case 2:
-            return Soprano::LiteralValue( d->m_properties[index.row()].second );
+            return Soprano::LiteralValue( d->m_properties[index.row()].creationDate );
         }
     }
 
@@ -324,9 +1016,262 @@ Qt::ItemFlags Nepomuk2::ResourcePropertyEditModel::flags( const QModelIndex& ind
 {
     Qt::ItemFlags flags = QAbstractItemModel::flags( index );
     // FIXME: implement resource range editing
-    if( index.column() == 1 && d->m_properties[index.row()].first.object().isLiteral() )
+    if( index.column() == 1 &&
+        d->m_properties[index.row()].statement.object().isLiteral() &&
+        d->m_properties[index.row()].fullLength < 0 )
         flags |= Qt::ItemIsEditable;
     return flags;
 }
 
+
+bool Nepomuk2::ResourcePropertyEditModel::isPartial( const QModelIndex& index ) const
+{
+    return( index.isValid() &&
+            index.row() < d->m_properties.count() &&
+            d->m_properties[index.row()].fullLength >= 0 );
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::loadFullValue( const QModelIndex& index )
+{
+    if( !isPartial( index ) )
+        return;
+
+    if( d->m_fullValueQuery ) {
+        d->m_fullValueQuery->close();
+        d->m_fullValueQuery->disconnect( this );
+    }
+
+    d->m_fullValueIndex = index;
+    d->m_fullValueQuery = Soprano::Util::AsyncQuery::executeQuery( ResourceManager::instance()->mainModel(),
+                                                                   d->fullValueQuery( index.row() ),
+                                                                   Soprano::Query::QueryLanguageSparql );
+    connect( d->m_fullValueQuery, SIGNAL(nextReady(Soprano::Util::AsyncQuery*)),
+             this, SLOT(slotFullValueResultReady(Soprano::Util::AsyncQuery*)) );
+    connect( d->m_fullValueQuery, SIGNAL(finished(Soprano::Util::AsyncQuery*)),
+             this, SLOT(slotFullValueQueryFinished(Soprano::Util::AsyncQuery*)) );
+}
+
+
+int Nepomuk2::ResourcePropertyEditModel::totalCount() const
+{
+    return d->m_totalCount;
+}
+
+
+bool Nepomuk2::ResourcePropertyEditModel::isComplete() const
+{
+    return d->m_complete;
+}
+
+
+Nepomuk2::ResourcePropertyEditModel::StatementList Nepomuk2::ResourcePropertyEditModel::statements() const
+{
+    return d->m_properties;
+}
+
+
+bool Nepomuk2::ResourcePropertyEditModel::canRestore() const
+{
+    // The pages skip predicates loaded by an update. That is not part of the
+    // statements, thus, such a table cannot be paged after restoring it.
+    return( d->m_resource.isValid() &&
+            d->m_changedPredicates.isEmpty() &&
+            !d->m_updateQuery &&
+            ( d->m_complete || d->m_updatedPredicates.isEmpty() ) );
+}
+
+
+bool Nepomuk2::ResourcePropertyEditModel::canFetchMore( const QModelIndex& parent ) const
+{
+    return !parent.isValid() && d->m_hasMore && !d->m_query && !d->m_updateQuery;
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::fetchMore( const QModelIndex& parent )
+{
+    if( canFetchMore( parent ) ) {
+        d->startPageQuery( s_pageSize );
+    }
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::slotNextResultReady( Soprano::Util::AsyncQuery* query )
+{
+    if( d->m_pendingProperties.count() < d->m_pageSize ) {
+        d->m_pendingProperties.append( d->propertyFromQuery( query ) );
+        query->next();
+    }
+    else {
+        // the row beyond the page: there is more, wait for fetchMore()
+        d->m_hasMore = true;
+        query->close();
+        query->disconnect( this );
+        d->m_query = 0;
+        d->pageLoaded();
+    }
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::slotQueryFinished( Soprano::Util::AsyncQuery* query )
+{
+    d->m_query = 0;
+
+    if( query->lastError() ) {
+        kDebug() << query->lastError();
+        d->flushPendingProperties();
+    }
+    else {
+        d->pageLoaded();
+    }
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::slotCountResultReady( Soprano::Util::AsyncQuery* query )
+{
+    d->setTotalCount( query->binding( QLatin1String( "c" ) ).literal().toInt() );
+    query->next();
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::slotCountQueryFinished( Soprano::Util::AsyncQuery* query )
+{
+    d->m_countQuery = 0;
+    if( query->lastError() ) {
+        kDebug() << query->lastError();
+        d->m_countFailed = true;
+    }
+}
+
+void Nepomuk2::ResourcePropertyEditModel::slotResourceInfoResultReady( Soprano::Util::AsyncQuery* query )
+{
+    const QUrl resource = query->binding( QLatin1String( "r" ) ).uri();
+    const QUrl property = query->binding( QLatin1String( "p" ) ).uri();
+    const Soprano::Node value = query->binding( QLatin1String( "v" ) );
+
+    Private::ResourceInfo& info = d->m_resourceInfo[resource];
+    if( property == Soprano::Vocabulary::RDF::type() ) {
+        info.types << value.uri();
+    }
+    else if( property == Soprano::Vocabulary::NAO::hasSymbol() ) {
+        if( value.isLiteral() )
+            info.iconName = value.toString();
+    }
+    else {
+        const int rank = labelProperties().indexOf( property );
+        if( info.labelRank < 0 || rank < info.labelRank ) {
+            info.label = value.toString();
+            info.labelRank = rank;
+        }
+    }
+
+    query->next();
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::slotResourceInfoQueryFinished( Soprano::Util::AsyncQuery* query )
+{
+    d->m_resourceInfoQuery = 0;
+    if( query->lastError() ) {
+        kDebug() << query->lastError();
+    }
+
+    if( !d->m_properties.isEmpty() )
+        emit dataChanged( index( 0, 1 ), index( d->m_properties.count() - 1, 1 ) );
+
+    // resources of pages which came in while we were querying
+    d->startResourceInfoQuery();
+}
+
+void Nepomuk2::ResourcePropertyEditModel::slotFullValueResultReady( Soprano::Util::AsyncQuery* query )
+{
+    const QModelIndex index = d->m_fullValueIndex;
+    if( index.isValid() ) {
+        StatementInfo& info = d->m_properties[index.row()];
+        info.statement.setObject( query->binding( 0 ) );
+        info.fullLength = -1;
+        emit dataChanged( index, index );
+        emit fullValueLoaded( index );
+    }
+    query->next();
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::slotFullValueQueryFinished( Soprano::Util::AsyncQuery* query )
+{
+    d->m_fullValueQuery = 0;
+    d->m_fullValueIndex = QModelIndex();
+    if( query->lastError() ) {
+        kDebug() << query->lastError();
+    }
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::slotGraphsLoaded( const QList<QUrl>& graphs )
+{
+    const QSet<QUrl> graphSet = graphs.toSet();
+    int first = -1;
+    int last = -1;
+    for( int i = 0; i < d->m_properties.count(); ++i ) {
+        StatementInfo& info = d->m_properties[i];
+        if( graphSet.contains( info.statement.context().uri() ) ) {
+            info.creationDate = GraphMetadataCache::self()->creationDate( info.statement.context().uri() );
+            if( first < 0 )
+                first = i;
+            last = i;
+        }
+    }
+
+    if( first >= 0 )
+        emit dataChanged( index( first, 2 ), index( last, 2 ) );
+}
+
+void Nepomuk2::ResourcePropertyEditModel::propertyChanged( const Nepomuk2::Types::Property& property )
+{
+    // the statements of other resources cannot be watched, backlinks are not updated
+    if( d->m_mode != PropertiesMode || !d->m_resource.isValid() )
+        return;
+
+    d->m_changedPredicates.insert( property.uri() );
+    if( !d->m_updateTimer.isActive() )
+        d->m_updateTimer.start();
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::reload()
+{
+    d->rebuild();
+    reset();
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::slotUpdate()
+{
+    d->startUpdateQuery();
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::slotUpdateResultReady( Soprano::Util::AsyncQuery* query )
+{
+    d->m_updateResults.append( d->propertyFromQuery( query ) );
+    query->next();
+}
+
+
+void Nepomuk2::ResourcePropertyEditModel::slotUpdateQueryFinished( Soprano::Util::AsyncQuery* query )
+{
+    d->m_updateQuery = 0;
+    if( query->lastError() ) {
+        kDebug() << query->lastError();
+        d->m_updateResults.clear();
+    }
+    else {
+        d->applyUpdate();
+    }
+
+    // changes which came in while we were updating
+    if( !d->m_changedPredicates.isEmpty() && !d->m_updateTimer.isActive() )
+        d->m_updateTimer.start();
+}
+
 #include "resourcepropertymodel.moc"
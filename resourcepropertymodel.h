@@ -21,15 +21,22 @@
 
 #include <QtCore/QAbstractTableModel>
 #include <QtCore/QList>
+#include <QtCore/QDateTime>
 
 #include <Soprano/Statement>
 #include <Soprano/Node>
 
+namespace Soprano {
+    namespace Util {
+        class AsyncQuery;
+    }
+}
 
 
 namespace Nepomuk2 {
     class Resource;
     namespace Types {
+        class Property;
     }
 
     class ResourcePropertyEditModel : public QAbstractTableModel
@@ -62,20 +69,135 @@ namespace Nepomuk2 {
         QVariant headerData( int section, Qt::Orientation orientation, int role = Qt::DisplayRole ) const;
 
         bool removeRows( int row, int count, const QModelIndex& parent = QModelIndex() );
+
+        /**
+         * Remove the statements of all rows in \p indexes from the store
+         * with a single call.
+         * \return \p false if nothing was removed, e.g. because the complete
+         * value of a partially loaded literal could not be found.
+         */
+        bool removeStatements( const QModelIndexList& indexes );
         bool setData( const QModelIndex& index, const QVariant& value, int role );
 
         Soprano::Node nodeForIndex( const QModelIndex& index ) const;
 
+        /**
+         * The statements are loaded asynchronously one page at a time. Use
+         * fetchMore() to load the next page.
+         */
+        bool canFetchMore( const QModelIndex& parent ) const;
+        void fetchMore( const QModelIndex& parent );
+
+        /**
+         * \return The total number of statements or -1 if not known yet.
+         * \sa totalCountChanged()
+         */
+        int totalCount() const;
+
+        /**
+         * \return \p true if only the beginning of the literal value of
+         * \p index has been loaded. Such values cannot be edited before
+         * loadFullValue() is done.
+         */
+        bool isPartial( const QModelIndex& index ) const;
+
+        /**
+         * Load the complete value of a partially loaded literal in the
+         * background.
+         * \sa fullValueLoaded()
+         */
+        void loadFullValue( const QModelIndex& index );
+
+        /**
+         * A loaded statement together with the creation date of its graph.
+         */
+        struct StatementInfo {
+            StatementInfo() : fullLength( -1 ) {}
+
+            Soprano::Statement statement;
+            QDateTime creationDate;
+
+            /// Long literals are only loaded partially. This is their full length or -1 if the object is complete.
+            int fullLength;
+        };
+        typedef QList<StatementInfo> StatementList;
+
+        /**
+         * \return \p true once all statements of the resource have been loaded.
+         */
+        bool isComplete() const;
+
+        /**
+         * \return The loaded statements together with their creation dates.
+         * Can be used with setResource( const Resource&, const StatementList&, bool )
+         * to show the resource again without querying.
+         */
+        StatementList statements() const;
+
+        /**
+         * \return \p true if statements() can be restored with setResource(), i.e.
+         * there are no pending changes and the remaining pages can be loaded later on.
+         */
+        bool canRestore() const;
+
         enum CustomRoles {
             PropertyRole = 3468698
         };
 
+    Q_SIGNALS:
+        /**
+         * Emitted once the total number of statements is known.
+         */
+        void totalCountChanged( int count );
+
+        /**
+         * Emitted once the complete value of \p index has been loaded
+         * via loadFullValue().
+         */
+        void fullValueLoaded( const QModelIndex& index );
+
     public Q_SLOTS:
         /**
          * Se the resource to edit.
          */
         void setResource( const Resource& resource );
 
+        /**
+         * Set the resource to edit using \p statements as obtained
+         * from statements() instead of querying them. Unless \p complete
+         * is \p true the remaining statements are loaded via fetchMore().
+         */
+        void setResource( const Resource& resource,
+                          const Nepomuk2::ResourcePropertyEditModel::StatementList& statements,
+                          bool complete = true );
+
+        /**
+         * Tell the model that the values of \p property of the resource have changed.
+         * The model does not watch the resource itself, this is up to the user which
+         * typically watches more than one resource anyway. The changes are collected
+         * and applied to the loaded rows with a slight delay. Backlinks are not updated.
+         */
+        void propertyChanged( const Nepomuk2::Types::Property& property );
+
+        /**
+         * Load all statements of the resource again, for example after it has been removed.
+         */
+        void reload();
+
+    private Q_SLOTS:
+        void slotNextResultReady( Soprano::Util::AsyncQuery* query );
+        void slotQueryFinished( Soprano::Util::AsyncQuery* query );
+        void slotCountResultReady( Soprano::Util::AsyncQuery* query );
+        void slotCountQueryFinished( Soprano::Util::AsyncQuery* query );
+        void slotResourceInfoResultReady( Soprano::Util::AsyncQuery* query );
+        void slotResourceInfoQueryFinished( Soprano::Util::AsyncQuery* query );
+        void slotFullValueResultReady( Soprano::Util::AsyncQuery* query );
+        void slotFullValueQueryFinished( Soprano::Util::AsyncQuery* query );
+        void slotGraphsLoaded( const QList<QUrl>& graphs );
+        void slotUpdate();
+        void slotUpdateResultReady( Soprano::Util::AsyncQuery* query );
+        void slotUpdateQueryFinished( Soprano::Util::AsyncQuery* query );
+
     private:
         class Private;
         Private* const d;
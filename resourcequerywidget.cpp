@@ -21,10 +21,19 @@ Copyright (c) 2010 Sebastian Trueg <trueg@kde.org>
 
 #include "resourcequerywidget.h"
 #include "querymodel.h"
+#include "sparqlparser.h"
+#include "sparqlformatter.h"
+#include "sparqlvalidator.h"
+#include "queryplandialog.h"
+#include "queryplanbackend.h"
+#include "prefixregistry.h"
+#include "queryhistorydialog.h"
 
 #include <QtGui/QPlainTextEdit>
 #include <QtGui/QPushButton>
 #include <QtGui/QFont>
+#include <QtGui/QTableWidget>
+#include <QtCore/QTimer>
 
 #include <KIcon>
 #include <KConfigGroup>
@@ -35,11 +44,22 @@ Copyright (c) 2010 Sebastian Trueg <trueg@kde.org>
 #include <Soprano/Node>
 
 #include <Nepomuk2/Resource>
+#include <Nepomuk2/ResourceManager>
+
+
+namespace {
+/// The number of queries whose templates are kept for repeated runs
+const int s_maxPreparedQueries = 20;
+
+/// The time in msecs after the last edit before the parameter panel is updated
+const int s_parameterUpdateDelay = 300;
+}
 
 
 ResourceQueryWidget::ResourceQueryWidget( QWidget* parent )
     : QWidget( parent ),
-    m_queryHistoryIndex( 0 )
+    m_queryHistoryIndex( 0 ),
+    m_preparedQueries( s_maxPreparedQueries )
 {
     setupUi( this );
 
@@ -73,6 +93,26 @@ ResourceQueryWidget::ResourceQueryWidget( QWidget* parent )
     connect( m_queryModel, SIGNAL(queryFinished()),
              this, SLOT(slotQueryFinished()) );
     connect( m_shorten, SIGNAL(clicked()),this,SLOT(slotQueryShortenButtonClicked()));
+    connect( m_explainButton, SIGNAL(clicked()),
+             this, SLOT(slotExplainButtonClicked()) );
+    connect( m_historyButton, SIGNAL(clicked()),
+             this, SLOT(slotHistoryButtonClicked()) );
+    connect( m_runAllBindingsButton, SIGNAL(clicked()),
+             this, SLOT(slotRunAllBindingsButtonClicked()) );
+    connect( m_addBindingButton, SIGNAL(clicked()),
+             this, SLOT(slotAddBindingSet()) );
+    connect( m_removeBindingButton, SIGNAL(clicked()),
+             this, SLOT(slotRemoveBindingSet()) );
+
+    // the parameter panel follows the "$name" parameters in the query
+    m_parameterTimer = new QTimer( this );
+    m_parameterTimer->setSingleShot( true );
+    m_parameterTimer->setInterval( s_parameterUpdateDelay );
+    connect( m_queryEdit, SIGNAL(textChanged()),
+             m_parameterTimer, SLOT(start()) );
+    connect( m_parameterTimer, SIGNAL(timeout()),
+             this, SLOT(slotUpdateParameters()) );
+    m_parameterPanel->hide();
     m_buttonForward->setEnabled( false );
     m_buttonBack->setEnabled( false );
     m_stopQueryButton->setEnabled(false);
@@ -118,27 +158,175 @@ void ResourceQueryWidget::saveSettings( KConfigGroup& cfg ) const
 
 
 void ResourceQueryWidget::slotQueryButtonClicked()
+{
+    runEditorQuery( false );
+}
+
+
+void ResourceQueryWidget::slotRunAllBindingsButtonClicked()
+{
+    runEditorQuery( true );
+}
+
+
+void ResourceQueryWidget::runEditorQuery( bool allBindingSets )
 {
     const QString query = m_queryEdit->toPlainText();
+    // prepared queries have been checked before
+    if( !m_preparedQueries.contains( query ) && !checkQuerySyntax( query, 0 ) )
+        return;
+    if( !startQuery( query, allBindingSets ) )
+        return;
+
     if( m_queryHistory.count() == 1 || m_queryHistory[m_queryHistory.count()-2] != query ) {
         m_queryHistoryIndex = m_queryHistory.count();
         m_queryHistory.insert(m_queryHistory.count()-1, m_queryEdit->toPlainText() );
     }
-    m_queryModel->setQuery( query );
-    m_stopQueryButton->setEnabled(true);
     updateHistoryButtonStates();
 }
 
 
+bool ResourceQueryWidget::checkQuerySyntax( const QString& query, int offset )
+{
+    // do not bother the store with queries which cannot be parsed anyway
+    const QList<Nepomuk2::SparqlSyntaxError> errors = Nepomuk2::SparqlValidator::validate( query );
+    if( errors.isEmpty() )
+        return true;
+
+    const Nepomuk2::SparqlSyntaxError& error = errors.first();
+    QTextCursor cursor = m_queryEdit->textCursor();
+    cursor.setPosition( offset + error.position );
+    m_queryEdit->setTextCursor( cursor );
+    m_statusLabel->setText( i18n( "Syntax error: %1", error.message() ) );
+    return false;
+}
+
+
+bool ResourceQueryWidget::startQuery( const QString& query, bool allBindingSets )
+{
+    const QString boundQuery = this->boundQuery( query, allBindingSets );
+    if( boundQuery.isEmpty() )
+        return false;
+
+    // the model drops the running query without finishing it
+    if( !m_runningQuery.isEmpty() ) {
+        m_currentRun.error = i18n( "Interrupted by the next query" );
+        m_currentRun.duration = m_currentRun.time.msecsTo( QDateTime::currentDateTime() );
+        m_currentRun.rowCount = m_queryModel->rowCount();
+        m_runHistory.addRun( m_runningQuery, m_currentRun );
+    }
+
+    m_runningQuery = query;
+    m_currentRun = Nepomuk2::QueryRun();
+    m_currentRun.time = QDateTime::currentDateTime();
+
+    m_queryModel->setQuery( boundQuery );
+    m_stopQueryButton->setEnabled(true);
+    return true;
+}
+
+
+QString ResourceQueryWidget::boundQuery( const QString& query, bool allBindingSets )
+{
+    // Soprano has no prepared queries. Instead we keep the tokenized template with
+    // its prefix declarations so that a new binding only needs a concatenation.
+    Nepomuk2::QueryTemplate* queryTemplate = m_preparedQueries.object( query );
+    if( !queryTemplate ) {
+        queryTemplate = new Nepomuk2::QueryTemplate( Nepomuk2::PrefixRegistry::self()->addPrefixDeclarations( query ) );
+        m_preparedQueries.insert( query, queryTemplate );
+    }
+
+    if( queryTemplate->parameters().isEmpty() || m_parameterTable->rowCount() == 0 )
+        return queryTemplate->query();
+
+    QList<QHash<QString, QString> > bindingSets;
+    if( allBindingSets ) {
+        for( int row = 0; row < m_parameterTable->rowCount(); ++row )
+            bindingSets << bindingSet( row );
+    }
+    else {
+        bindingSets << bindingSet( qMax( 0, m_parameterTable->currentRow() ) );
+    }
+
+    // only the template has been checked, the values are written by the user, too
+    const QString boundQuery = queryTemplate->bind( bindingSets );
+    if( boundQuery != queryTemplate->query() ) {
+        const QList<Nepomuk2::SparqlSyntaxError> errors = Nepomuk2::SparqlValidator::validate( boundQuery );
+        if( !errors.isEmpty() ) {
+            m_statusLabel->setText( i18n( "Invalid parameter value: %1", errors.first().message() ) );
+            return QString();
+        }
+    }
+    return boundQuery;
+}
+
+
+QHash<QString, QString> ResourceQueryWidget::bindingSet( int row ) const
+{
+    QHash<QString, QString> values;
+    for( int column = 0; column < m_parameterNames.count(); ++column ) {
+        if( QTableWidgetItem* item = m_parameterTable->item( row, column ) )
+            values.insert( m_parameterNames[column], item->text() );
+    }
+    return values;
+}
+
+
+void ResourceQueryWidget::slotUpdateParameters()
+{
+    const QStringList parameters = Nepomuk2::QueryTemplate( m_queryEdit->toPlainText() ).parameters();
+    m_parameterPanel->setVisible( !parameters.isEmpty() );
+    if( parameters == m_parameterNames )
+        return;
+
+    // keep the values of the parameters which are still used
+    QList<QHash<QString, QString> > bindingSets;
+    for( int row = 0; row < m_parameterTable->rowCount(); ++row )
+        bindingSets << bindingSet( row );
+
+    m_parameterNames = parameters;
+    QStringList labels;
+    Q_FOREACH( const QString& name, parameters ) {
+        labels << QLatin1Char( '$' ) + name;
+    }
+    m_parameterTable->clear();
+    m_parameterTable->setColumnCount( parameters.count() );
+    m_parameterTable->setHorizontalHeaderLabels( labels );
+    m_parameterTable->setRowCount( qMax( 1, bindingSets.count() ) );
+    for( int row = 0; row < bindingSets.count(); ++row ) {
+        for( int column = 0; column < parameters.count(); ++column )
+            m_parameterTable->setItem( row, column, new QTableWidgetItem( bindingSets[row].value( parameters[column] ) ) );
+    }
+}
+
+
+void ResourceQueryWidget::slotAddBindingSet()
+{
+    m_parameterTable->insertRow( m_parameterTable->rowCount() );
+    m_parameterTable->setCurrentCell( m_parameterTable->rowCount()-1, 0 );
+}
+
+
+void ResourceQueryWidget::slotRemoveBindingSet()
+{
+    if( m_parameterTable->rowCount() > 1 )
+        m_parameterTable->removeRow( qMax( 0, m_parameterTable->currentRow() ) );
+}
+
+
 void ResourceQueryWidget::slotQuerySelectionButtonClicked()
 {
     const QString query = m_queryEdit->textCursor().selectedText();
+    if( !m_preparedQueries.contains( query ) &&
+        !checkQuerySyntax( query, m_queryEdit->textCursor().selectionStart() ) )
+        return;
+    if( !startQuery( query ) )
+        return;
+
     if( m_queryHistory.count() == 1 || m_queryHistory[m_queryHistory.count()-2] != query ) {
         m_queryHistoryIndex = m_queryHistory.count();
         m_queryHistory.insert(m_queryHistory.count()-1, m_queryEdit->toPlainText() );
     }
-    m_queryModel->setQuery( query );
-    m_stopQueryButton->setEnabled(true);
     updateHistoryButtonStates();
 }
 
@@ -210,6 +398,7 @@ bool ResourceQueryWidget::eventFilter( QObject* watched, QEvent* event )
 
 void ResourceQueryWidget::slotQueryError(const Soprano::Error::Error& error)
 {
+    m_currentRun.error = error.message();
     KMessageBox::error( 0, error.message(), i18n("Query error") );
 }
 
@@ -217,89 +406,63 @@ void ResourceQueryWidget::slotQueryFinished()
 {
     m_statusLabel->setText( i18n("Elapsed: %1", KGlobal::locale()->formatDuration(m_queryModel->queryTime())) );
     m_stopQueryButton->setEnabled(false);
+
+    if( !m_runningQuery.isEmpty() ) {
+        m_currentRun.duration = m_queryModel->queryTime();
+        m_currentRun.rowCount = m_queryModel->rowCount();
+        m_runHistory.addRun( m_runningQuery, m_currentRun );
+        m_runningQuery.clear();
+    }
 }
 
 void ResourceQueryWidget::slotQueryStopButtonClicked()
 {
+    m_currentRun.error = i18n( "Stopped by the user" );
     m_queryModel->stopQuery();
     m_stopQueryButton->setEnabled(false);
 }
 
 void ResourceQueryWidget::slotQueryShortenButtonClicked()
 {
-    QString query = m_queryEdit->toPlainText();
-    QRegExp rx("<[\\w]+://[\\w\\d-_.]+(/[\\d\\w/-._]+/)*([\\w\\d-._]+)#([\\w\\d]+)>");
-    query.replace(rx,"\\2:\\3");
-    query.replace( QLatin1String("rdf-schema:"), QLatin1String("rdfs:") );
-    query.replace( QLatin1String("22-rdf-syntax-ns:"), QLatin1String("rdf:") );
-    query.replace( QLatin1String("XMLSchema:"), QLatin1String("xsd:") );
-    query= query.simplified();
-    m_queryEdit->setPlainText( query );
+    Nepomuk2::SparqlSyntaxNode query = Nepomuk2::SparqlParser::parse( m_queryEdit->toPlainText() );
+    Nepomuk2::SparqlFormatter::compactPrefixes( query );
+    m_queryEdit->setPlainText( Nepomuk2::SparqlFormatter::toSingleLine( query ) );
 }
 
-void ResourceQueryWidget::autoIndentQuery()
+void ResourceQueryWidget::slotExplainButtonClicked()
 {
-    QString query = m_queryEdit->toPlainText();
-    query= query.simplified();
-    QString newQuery;
-    int i = 0;
-    int indent = 0;
-    int space = 4;
-
-    while(i < query.size()) {
-        newQuery.append(query[i]);
-        if(query[i] != QLatin1Char('"') && query[i] != QLatin1Char('<') && query[i] != QLatin1Char('\'')) {
-            if(query[i] == QLatin1Char('{')) {
-                indent++;
-                newQuery.append('\n');
-                newQuery.append(QString().fill(QLatin1Char(' '), indent*space));
-            }
-            else if (query[i] == QLatin1Char('.')) {
-                if(i+2<query.size()) {
-                    if(query[i+1] == QLatin1Char('}')||query[i+2] == QLatin1Char('}')) {
-                        newQuery.append('\n');
-                        newQuery.append(QString().fill(QLatin1Char(' '), (indent-1)*space));
-                    }
-                    else {
-                        newQuery.append('\n');
-                        newQuery.append(QString().fill(QLatin1Char(' '), indent*space));
-                    }
-                }
-                else {
-                    newQuery.append('\n');
-                    newQuery.append(QString().fill(QLatin1Char(' '), indent*space));
-                }
-            }
-            else if (query[i] == QLatin1Char('}')) {
-                indent--;
-                if(i+2<query.size()) {
-                    if(query[i+2] == QLatin1Char('.')||query[i+1] == QLatin1Char('.'))
-                        newQuery.append(QString().fill(QLatin1Char(' '), 1));
-                    else {
-                        newQuery.append('\n');
-                        newQuery.append(QString().fill(QLatin1Char(' '), indent*space));
-                    }
-                }
-                else {
-                    newQuery.append('\n');
-                    newQuery.append(QString().fill(QLatin1Char(' '), indent*space));
-                }
-            }
-        }
-        else {
-            i++;
-            while(i < query.size()) {
-                if(query[i] == QLatin1Char('"') || query[i] == QLatin1Char('>') || query[i] == QLatin1Char('\'')) {
-                    newQuery.append(query[i]);
-                    break;
-                }
-                newQuery.append(query[i]);
-                i++;
-            }
-        }
-        i++;
+    const QString query = m_queryEdit->toPlainText();
+    if( !checkQuerySyntax( query, 0 ) )
+        return;
+    const QString boundQuery = this->boundQuery( query, false );
+    if( boundQuery.isEmpty() )
+        return;
+
+    // Nepomuk always stores its data in Virtuoso
+    QueryPlanDialog* dlg = new QueryPlanDialog( new Nepomuk2::VirtuosoQueryPlanBackend(),
+                                                Nepomuk2::ResourceManager::instance()->mainModel(),
+                                                this );
+    dlg->setAttribute( Qt::WA_DeleteOnClose );
+    dlg->explain( boundQuery );
+    dlg->show();
+}
+
+void ResourceQueryWidget::slotHistoryButtonClicked()
+{
+    // the log is only read when it is needed
+    if( !m_runHistory.isLoaded() )
+        m_runHistory.load();
+
+    QueryHistoryDialog dlg( &m_runHistory, this );
+    if( dlg.exec() == QDialog::Accepted ) {
+        m_queryEdit->setPlainText( dlg.selectedQuery() );
     }
-    m_queryEdit->setPlainText( newQuery );
+}
+
+void ResourceQueryWidget::autoIndentQuery()
+{
+    const Nepomuk2::SparqlSyntaxNode query = Nepomuk2::SparqlParser::parse( m_queryEdit->toPlainText() );
+    m_queryEdit->setPlainText( Nepomuk2::SparqlFormatter::prettyPrint( query ) );
 }
 
 #include "resourcequerywidget.moc"
@@ -23,6 +23,7 @@
 
 #include <QtGui/QWidget>
 #include <QtCore/QTime>
+#include <QtCore/QCache>
 
 #include <Nepomuk2/Resource>
 #include <Nepomuk2/Types/Class>
@@ -30,9 +31,12 @@
 #include <Soprano/Error/Error>
 
 #include "ui_resourcequerywidget.h"
+#include "queryhistory.h"
+#include "querytemplate.h"
 
 class KConfigGroup;
 class QEvent;
+class QTimer;
 namespace Nepomuk2 {
     class QueryModel;
 }
@@ -66,17 +70,42 @@ private Q_SLOTS:
     void slotQueryError( const Soprano::Error::Error & error );
     void slotQueryFinished();
     void slotQueryShortenButtonClicked();
+    void slotExplainButtonClicked();
+    void slotHistoryButtonClicked();
+    void slotRunAllBindingsButtonClicked();
+    void slotUpdateParameters();
+    void slotAddBindingSet();
+    void slotRemoveBindingSet();
 
 public Q_SLOTS:
     void autoIndentQuery();
 
 private:
     void updateHistoryButtonStates();
+    bool checkQuerySyntax( const QString& query, int offset );
+    void runEditorQuery( bool allBindingSets );
+    bool startQuery( const QString& query, bool allBindingSets = false );
+    QString boundQuery( const QString& query, bool allBindingSets );
+    QHash<QString, QString> bindingSet( int row ) const;
 
     Nepomuk2::QueryModel* m_queryModel;
 
     QStringList m_queryHistory;
     int m_queryHistoryIndex;
+
+    /// every run with its statistics, unlike m_queryHistory which is only used for browsing
+    Nepomuk2::QueryHistory m_runHistory;
+
+    /// the running query as typed by the user and its start time and error
+    QString m_runningQuery;
+    Nepomuk2::QueryRun m_currentRun;
+
+    /// the checked and prefix-expanded templates of recently run queries, mapped by the typed text
+    QCache<QString, Nepomuk2::QueryTemplate> m_preparedQueries;
+
+    /// the parameters shown in the columns of m_parameterTable
+    QStringList m_parameterNames;
+    QTimer* m_parameterTimer;
 };
 
 #endif
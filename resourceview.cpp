@@ -19,6 +19,7 @@
  */
 
 #include "resourceview.h"
+#include "resourcelistproxymodel.h"
 #include "nepomukshellsettings.h"
 #include "mainwindow.h"
 
@@ -37,24 +38,37 @@
 #include <KDebug>
 #include <KIcon>
 #include <KActionCollection>
+#include <KAction>
 
 #include <QtGui/QAction>
 #include <QtGui/QMenu>
+#include <QtGui/QHeaderView>
 #include <QtGui/QDropEvent>
 #include <QtCore/QMimeData>
+#include <QtCore/QTimer>
 
 Q_DECLARE_METATYPE(Nepomuk2::Types::Class)
 
+namespace {
+/// Queries finishing faster than this (in ms) do not show the busy indicator at all
+const int s_busyIndicatorDelay = 150;
+}
+
 
 ResourceView::ResourceView( QWidget* parent )
     : QWidget( parent ),
+      m_queryClient(0),
       m_queryCount(-1),
       m_queryPage(1)
 {
     setupUi(this);
 
     m_resourceModel = new Nepomuk2::Utils::SimpleResourceModel( this );
-    m_resourceView->setModel( m_resourceModel );
+    m_sortModel = new Nepomuk2::ResourceListProxyModel( this );
+    m_sortModel->setSourceModel( m_resourceModel );
+    m_resourceView->setModel( m_sortModel );
+    m_resourceView->sortByColumn( Nepomuk2::Utils::ResourceModel::ResourceColumn, Qt::AscendingOrder );
+    m_resourceView->header()->setContextMenuPolicy( Qt::CustomContextMenu );
     //m_resourceView->setSpacing( KDialog::spacingHint() );
 
     connect( m_resourceView->selectionModel(), SIGNAL(selectionChanged(QItemSelection,QItemSelection)),
@@ -63,12 +77,23 @@ ResourceView::ResourceView( QWidget* parent )
              this, SLOT(slotIndexActivated(QModelIndex)) );
     connect( m_resourceView, SIGNAL(customContextMenuRequested(QPoint)),
              this, SLOT(slotResourceViewContextMenu(QPoint)) );
-
-    m_queryClient = new Nepomuk2::Query::QueryServiceClient( this );
-    connect( m_queryClient, SIGNAL(newEntries(QList<Nepomuk2::Query::Result>)),
-             m_resourceModel, SLOT(addResults(QList<Nepomuk2::Query::Result>)) );
-    connect( m_queryClient, SIGNAL(finishedListing()),
-             this, SLOT(updatePageButtons()) );
+    connect( m_resourceView->header(), SIGNAL(customContextMenuRequested(QPoint)),
+             this, SLOT(slotHeaderContextMenu(QPoint)) );
+    connect( m_filterEdit, SIGNAL(textChanged(QString)),
+             m_sortModel, SLOT(setFilterString(QString)) );
+
+    m_busyPainter = new KPixmapSequenceOverlayPainter( this );
+    m_busyPainter->setWidget( m_resourceView->viewport() );
+    m_busyTimer = new QTimer( this );
+    m_busyTimer->setSingleShot( true );
+    m_busyTimer->setInterval( s_busyIndicatorDelay );
+    connect( m_busyTimer, SIGNAL(timeout()),
+             this, SLOT(slotShowBusyIndicator()) );
+
+    m_cancelButton->setIcon( KIcon( QLatin1String("process-stop") ) );
+    m_cancelButton->hide();
+    connect( m_cancelButton, SIGNAL(clicked()),
+             this, SLOT(cancelQuery()) );
 
     m_pageBackButton->setIcon( KIcon( QLatin1String("go-previous") ) );
     m_pageForwardButton->setIcon( KIcon( QLatin1String("go-next") ) );
@@ -98,7 +123,7 @@ bool ResourceView::atEnd() const
         return m_queryPage*Settings::self()->queryLimit() >= m_queryCount;
     }
     else {
-        return m_queryClient->isListingFinished() && m_resourceModel->rowCount() < Settings::self()->queryLimit();
+        return ( !m_queryClient || m_queryClient->isListingFinished() ) && m_resourceModel->rowCount() < Settings::self()->queryLimit();
     }
 }
 
@@ -126,6 +151,12 @@ void ResourceView::addResource( const Nepomuk2::Resource& res )
 }
 
 
+void ResourceView::removeResources( const QList<QUrl>& uris )
+{
+    m_resourceModel->removeResources( uris );
+}
+
+
 void ResourceView::pageBack()
 {
     if( !atStart() ) {
@@ -202,6 +233,28 @@ void ResourceView::slotResourceViewContextMenu( const QPoint& pos )
 }
 
 
+void ResourceView::slotHeaderContextMenu( const QPoint& pos )
+{
+    // the creation date has no column of its own
+    KAction actionSortByDate( this );
+    actionSortByDate.setText( i18nc( "@action:inmenu", "Sort by Creation Date" ) );
+    actionSortByDate.setCheckable( true );
+    actionSortByDate.setChecked( m_sortModel->sortKey() == Nepomuk2::ResourceListProxyModel::SortByCreationDate );
+
+    if( QMenu::exec( QList<QAction*>() << &actionSortByDate,
+                     m_resourceView->header()->mapToGlobal( pos ) ) == &actionSortByDate ) {
+        if( actionSortByDate.isChecked() ) {
+            m_resourceView->header()->setSortIndicatorShown( false );
+            m_sortModel->setSortKey( Nepomuk2::ResourceListProxyModel::SortByCreationDate, Qt::DescendingOrder );
+        }
+        else {
+            m_resourceView->header()->setSortIndicatorShown( true );
+            m_sortModel->sort( m_resourceView->header()->sortIndicatorSection(), m_resourceView->header()->sortIndicatorOrder() );
+        }
+    }
+}
+
+
 void ResourceView::slotTotalResultCount(int count)
 {
     kDebug() << count;
@@ -210,13 +263,35 @@ void ResourceView::slotTotalResultCount(int count)
 }
 
 
+void ResourceView::cancelQuery()
+{
+    // Closing the client is not enough: newEntries batches which are already
+    // queued would still end up in the model. Thus, we drop the client
+    // including all its connections and use a fresh one for the next query.
+    if( m_queryClient ) {
+        m_queryClient->disconnect();
+        m_queryClient->close();
+        m_queryClient->deleteLater();
+        m_queryClient = 0;
+    }
+    hideBusyIndicator();
+    updatePageButtons();
+}
+
+
 void ResourceView::listQuery()
 {
-    // show busy thingi
-    KPixmapSequenceOverlayPainter* op = new KPixmapSequenceOverlayPainter( this );
-    op->setWidget( m_resourceView->viewport() );
-    connect( m_queryClient, SIGNAL(finishedListing()), op, SLOT(deleteLater()) );
-    op->start();
+    // a new query or page always supersedes the one still being listed
+    cancelQuery();
+
+    m_queryClient = new Nepomuk2::Query::QueryServiceClient( this );
+    connect( m_queryClient, SIGNAL(newEntries(QList<Nepomuk2::Query::Result>)),
+             m_resourceModel, SLOT(addResults(QList<Nepomuk2::Query::Result>)) );
+    connect( m_queryClient, SIGNAL(finishedListing()),
+             this, SLOT(slotFinishedListing()) );
+
+    // show busy thingi, but only if the query turns out to be slow
+    m_busyTimer->start();
 
     // start the query
     m_resourceModel->clear();
@@ -224,4 +299,26 @@ void ResourceView::listQuery()
     kDebug() << m_currentQuery;
 }
 
+
+void ResourceView::slotFinishedListing()
+{
+    hideBusyIndicator();
+    updatePageButtons();
+}
+
+
+void ResourceView::slotShowBusyIndicator()
+{
+    m_busyPainter->start();
+    m_cancelButton->show();
+}
+
+
+void ResourceView::hideBusyIndicator()
+{
+    m_busyTimer->stop();
+    m_busyPainter->stop();
+    m_cancelButton->hide();
+}
+
 #include "resourceview.moc"
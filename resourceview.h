@@ -26,6 +26,8 @@
 
 class QItemSelection;
 class QModelIndex;
+class QTimer;
+class KPixmapSequenceOverlayPainter;
 namespace Nepomuk2 {
     namespace Types {
         class Class;
@@ -37,6 +39,7 @@ namespace Nepomuk2 {
         class QueryServiceClient;
     }
     class Resource;
+    class ResourceListProxyModel;
 }
 
 /**
@@ -56,6 +59,12 @@ public:
 public Q_SLOTS:
     void setQuery( const Nepomuk2::Query::Query& query );
 
+    /**
+     * Stop listing the current query. Result batches which are
+     * still pending for it are dropped.
+     */
+    void cancelQuery();
+
     /**
      * Convenience method to quickly update the list
      * after creation of a resource without having to
@@ -63,6 +72,12 @@ public Q_SLOTS:
      */
     void addResource( const Nepomuk2::Resource& res );
 
+    /**
+     * Remove deleted resources from the list without
+     * re-running the query.
+     */
+    void removeResources( const QList<QUrl>& uris );
+
 Q_SIGNALS:
     void selectionChanged( const QList<Nepomuk2::Resource>& );
     void resourceActivated( const Nepomuk2::Resource& );
@@ -76,15 +91,25 @@ private Q_SLOTS:
     void slotIndexActivated( const QModelIndex& index );
     void slotResourceViewContextMenu( const QPoint& pos );
     void slotTotalResultCount( int );
+    void slotFinishedListing();
+    void slotShowBusyIndicator();
+    void slotHeaderContextMenu( const QPoint& pos );
 
 private:
     void listQuery();
     bool atStart() const;
     bool atEnd() const;
+    void hideBusyIndicator();
 
     Nepomuk2::Query::Query m_currentQuery;
     Nepomuk2::Query::QueryServiceClient* m_queryClient;
     Nepomuk2::Utils::SimpleResourceModel* m_resourceModel;
+    Nepomuk2::ResourceListProxyModel* m_sortModel;
+
+    /// one busy indicator for all queries which is only shown for slow ones
+    KPixmapSequenceOverlayPainter* m_busyPainter;
+    QTimer* m_busyTimer;
+
     int m_queryCount;
     int m_queryPage;
 };
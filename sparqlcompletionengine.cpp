@@ -0,0 +1,279 @@
+/*
+   Copyright (c) 2010-11 Vishesh Handa <handa.vish@gmail.com>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sparqlcompletionengine.h"
+
+#include <QtCore/QPair>
+#include <QtCore/QSet>
+#include <QtCore/QtAlgorithms>
+
+
+/**
+ * A prefix trie over the lower-cased keys of a set of terms.
+ *
+ * The keys are inserted in sorted order. Thus, the terms below any node form
+ * a contiguous range of m_values which is stored in the node itself.
+ */
+class Nepomuk2::SparqlCompletionEngine::Trie
+{
+public:
+    Trie() {
+        clear();
+    }
+
+    void clear() {
+        m_nodes.clear();
+        m_values.clear();
+        m_terms.clear();
+        m_nodes.append( Node() );
+    }
+
+    /**
+     * Each term is reachable through its full name and, for prefixed names,
+     * through the local name, i.e. "hasTag" also finds "nao:hasTag".
+     */
+    void build( const QStringList& terms ) {
+        clear();
+        m_terms = terms.toVector();
+
+        QList<QPair<QString, int> > keys;
+        for( int i = 0; i < m_terms.count(); ++i ) {
+            const QString& term = m_terms[i];
+            keys << qMakePair( term.toLower(), i );
+            const int colon = term.indexOf( QLatin1Char( ':' ) );
+            if( colon >= 0 && colon + 1 < term.length() )
+                keys << qMakePair( term.mid( colon + 1 ).toLower(), i );
+        }
+        qSort( keys );
+
+        QVector<int> lastChild( 1, -1 );
+        for( int k = 0; k < keys.count(); ++k ) {
+            const QString& key = keys[k].first;
+            int node = 0;
+            m_nodes[0].end = m_values.count() + 1;
+            for( int i = 0; i < key.length(); ++i ) {
+                const ushort c = key[i].unicode();
+                const int last = lastChild[node];
+                if( last >= 0 && m_nodes[last].c == c ) {
+                    // the keys are sorted, thus, a matching child is always the last one
+                    node = last;
+                }
+                else {
+                    Node child;
+                    child.c = c;
+                    child.begin = m_values.count();
+                    m_nodes.append( child );
+                    lastChild.append( -1 );
+                    const int childIndex = m_nodes.count() - 1;
+                    if( last >= 0 )
+                        m_nodes[last].nextSibling = childIndex;
+                    else
+                        m_nodes[node].firstChild = childIndex;
+                    lastChild[node] = childIndex;
+                    node = childIndex;
+                }
+                m_nodes[node].end = m_values.count() + 1;
+            }
+            m_values.append( keys[k].second );
+        }
+
+        m_nodes.squeeze();
+        m_values.squeeze();
+    }
+
+    /**
+     * Append the terms starting with \p prefix to \p result until it
+     * contains \p max terms.
+     */
+    void find( const QString& prefix, int max, QStringList& result, QSet<QString>& seen ) const {
+        int node = 0;
+        for( int i = 0; i < prefix.length() && node >= 0; ++i ) {
+            const ushort c = prefix[i].toLower().unicode();
+            int child = m_nodes[node].firstChild;
+            while( child >= 0 && m_nodes[child].c != c )
+                child = m_nodes[child].nextSibling;
+            node = child;
+        }
+        if( node < 0 )
+            return;
+
+        for( int i = m_nodes[node].begin; i < m_nodes[node].end && result.count() < max; ++i ) {
+            const QString& term = m_terms[m_values[i]];
+            if( !seen.contains( term ) ) {
+                seen.insert( term );
+                result.append( term );
+            }
+        }
+    }
+
+private:
+    struct Node {
+        Node() : c( 0 ), firstChild( -1 ), nextSibling( -1 ), begin( 0 ), end( 0 ) {}
+        ushort c;
+        int firstChild;
+        int nextSibling;
+
+        /// the range of m_values below this node
+        int begin;
+        int end;
+    };
+
+    QVector<Node> m_nodes;
+    QVector<int> m_values;
+    QVector<QString> m_terms;
+};
+
+
+namespace {
+    enum Context {
+        /// Before the graph pattern, i.e. in the query form and prolog
+        QueryHeader,
+        Subject,
+        Predicate,
+        Object,
+        /// The object of "a" or rdf:type
+        TypeObject
+    };
+
+    Context determineContext( const Nepomuk2::SparqlCompletionEngine::Position& position )
+    {
+        if( !position.inGroup )
+            return QueryHeader;
+
+        switch( position.terms.count() ) {
+        case 0:
+            return Subject;
+        case 1:
+            return Predicate;
+        default:
+            if( position.terms.count() == 2 &&
+                ( position.terms[1] == QLatin1String( "a" ) || position.terms[1] == QLatin1String( "rdf:type" ) ) )
+                return TypeObject;
+            return Object;
+        }
+    }
+
+    void appendMatching( const QStringList& candidates, const QString& word, int max, QStringList& result, QSet<QString>& seen )
+    {
+        Q_FOREACH( const QString& candidate, candidates ) {
+            if( result.count() >= max )
+                return;
+            if( candidate != word &&
+                candidate.startsWith( word, Qt::CaseInsensitive ) &&
+                !seen.contains( candidate ) ) {
+                seen.insert( candidate );
+                result.append( candidate );
+            }
+        }
+    }
+
+    QStringList sparqlKeywords()
+    {
+        return QStringList()
+            << QLatin1String( "prefix" ) << QLatin1String( "select" ) << QLatin1String( "distinct" ) << QLatin1String( "reduced" )
+            << QLatin1String( "construct" ) << QLatin1String( "describe" ) << QLatin1String( "ask" ) << QLatin1String( "from" )
+            << QLatin1String( "named" ) << QLatin1String( "where" ) << QLatin1String( "order" ) << QLatin1String( "by" ) << QLatin1String( "asc" )
+            << QLatin1String( "desc" ) << QLatin1String( "limit" ) << QLatin1String( "offset" ) << QLatin1String( "optional" )
+            << QLatin1String( "graph" ) << QLatin1String( "union" ) << QLatin1String( "filter" ) << QLatin1String( "str" )
+            << QLatin1String( "lang" ) << QLatin1String( "langmatches" ) << QLatin1String( "datatype" ) << QLatin1String( "bound" )
+            << QLatin1String( "sameTerm" ) << QLatin1String( "isIRI" ) << QLatin1String( "isURI" ) << QLatin1String( "isLiteral" )
+            << QLatin1String( "isBlank" ) << QLatin1String( "regex" ) << QLatin1String( "true" ) << QLatin1String( "false" );
+    }
+}
+
+
+Nepomuk2::SparqlCompletionEngine::SparqlCompletionEngine()
+    : m_keywords( new Trie() ),
+      m_classes( new Trie() ),
+      m_properties( new Trie() )
+{
+    m_keywords->build( sparqlKeywords() );
+}
+
+
+Nepomuk2::SparqlCompletionEngine::~SparqlCompletionEngine()
+{
+    delete m_keywords;
+    delete m_classes;
+    delete m_properties;
+}
+
+
+void Nepomuk2::SparqlCompletionEngine::setOntologyTerms( const QStringList& classes, const QStringList& properties )
+{
+    m_classes->build( classes );
+    m_properties->build( properties );
+}
+
+
+QStringList Nepomuk2::SparqlCompletionEngine::complete( const Position& position,
+                                                         const QStringList& variables,
+                                                         const QStringList& prefixes,
+                                                         const QString& word,
+                                                         int maxResults ) const
+{
+    QStringList result;
+    QSet<QString> seen;
+
+    if( word.startsWith( QLatin1Char( '?' ) ) || word.startsWith( QLatin1Char( '$' ) ) ) {
+        // no matter if the variable was written with '?' or '$'
+        QStringList candidates;
+        Q_FOREACH( const QString& variable, variables ) {
+            candidates << word.left( 1 ) + variable;
+        }
+        appendMatching( candidates, word, maxResults, result, seen );
+        return result;
+    }
+
+    switch( determineContext( position ) ) {
+    case QueryHeader:
+        m_keywords->find( word, maxResults, result, seen );
+        appendMatching( prefixes, word, maxResults, result, seen );
+        break;
+
+    case Subject:
+        appendMatching( prefixes, word, maxResults, result, seen );
+        m_keywords->find( word, maxResults, result, seen );
+        break;
+
+    case Predicate:
+        m_properties->find( word, maxResults, result, seen );
+        appendMatching( prefixes, word, maxResults, result, seen );
+        break;
+
+    case TypeObject:
+        m_classes->find( word, maxResults, result, seen );
+        appendMatching( prefixes, word, maxResults, result, seen );
+        break;
+
+    case Object:
+        appendMatching( prefixes, word, maxResults, result, seen );
+        m_classes->find( word, maxResults, result, seen );
+        m_properties->find( word, maxResults, result, seen );
+        break;
+    }
+
+    // anything else which matches, ranked below the candidates expected here
+    m_keywords->find( word, maxResults, result, seen );
+    m_properties->find( word, maxResults, result, seen );
+    m_classes->find( word, maxResults, result, seen );
+
+    return result;
+}
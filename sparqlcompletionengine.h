@@ -0,0 +1,95 @@
+/*
+   Copyright (c) 2010-11 Vishesh Handa <handa.vish@gmail.com>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPARQLCOMPLETIONENGINE_H
+#define SPARQLCOMPLETIONENGINE_H
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+namespace Nepomuk2 {
+
+    /**
+     * Provides the completion candidates for the QueryEditor.
+     *
+     * The ontology terms and keywords are stored in prefix tries, one per kind
+     * of term, which are built once. A lookup walks the typed prefix and then
+     * simply reads the matching terms from a contiguous range. Thus, the cost
+     * only depends on the length of the prefix and the number of results, not
+     * on the number of terms.
+     *
+     * The candidates are ranked by the position of the cursor in the query:
+     * properties after a subject, classes after "a", and the variables and
+     * prefixes used in the query itself.
+     */
+    class SparqlCompletionEngine
+    {
+    public:
+        SparqlCompletionEngine();
+        ~SparqlCompletionEngine();
+
+        /**
+         * Set the prefixed names of the ontology classes and properties,
+         * for example "nao:Tag" and "nao:hasTag".
+         */
+        void setOntologyTerms( const QStringList& classes, const QStringList& properties );
+
+        /**
+         * The part of the query in front of the word to complete. The editor
+         * determines it from the few lines before the cursor.
+         */
+        struct Position {
+            Position() : inGroup( false ) {}
+
+            /// false in the query header, i.e. before the first "{"
+            bool inGroup;
+
+            /// The terms of the current triple pattern in front of the word. After
+            /// ";" and "," the subject and predicate are empty terms.
+            QStringList terms;
+        };
+
+        /**
+         * \param position Where in the query \p word is.
+         * \param variables The names of the variables used in the query without "?".
+         * \param prefixes The prefixes declared in the query, for example "nao:".
+         * \param word The partial word to complete.
+         * \param maxResults The maximum number of results to return.
+         *
+         * \return The candidates in the order they should be presented.
+         */
+        QStringList complete( const Position& position,
+                              const QStringList& variables,
+                              const QStringList& prefixes,
+                              const QString& word,
+                              int maxResults = 50 ) const;
+
+    private:
+        Q_DISABLE_COPY( SparqlCompletionEngine )
+
+        class Trie;
+        Trie* m_keywords;
+        Trie* m_classes;
+        Trie* m_properties;
+    };
+}
+
+#endif
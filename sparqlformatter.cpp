@@ -0,0 +1,336 @@
+/*
+   Copyright (c) 2010-11 Vishesh Handa <handa.vish@gmail.com>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sparqlformatter.h"
+#include "sparqlparser.h"
+#include "prefixregistry.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QPair>
+#include <QtCore/QSet>
+
+
+namespace {
+    using Nepomuk2::SparqlSyntaxNode;
+    using Nepomuk2::SparqlTokenizer;
+
+    bool isSeparator( const SparqlSyntaxNode& node )
+    {
+        return( node.kind == SparqlSyntaxNode::Term &&
+                node.tokenType == SparqlTokenizer::Punctuation &&
+                ( node.text == QLatin1String( "." ) ||
+                  node.text == QLatin1String( "," ) ||
+                  node.text == QLatin1String( ";" ) ) );
+    }
+
+    class Printer
+    {
+    public:
+        Printer( int indentWidth, bool multiLine )
+            : m_indentWidth( indentWidth ),
+              m_multiLine( multiLine ),
+              m_atLineStart( true ),
+              m_bracketDepth( 0 ) {
+        }
+
+        QString result() const {
+            QString out = m_out;
+            while( out.endsWith( QLatin1Char( ' ' ) ) || out.endsWith( QLatin1Char( '\n' ) ) )
+                out.chop( 1 );
+            return out;
+        }
+
+        void printSequence( const QList<SparqlSyntaxNode>& nodes, int indent ) {
+            bool afterGroup = false;
+            Q_FOREACH( const SparqlSyntaxNode& node, nodes ) {
+                // anything but a separator following a group goes on a new line
+                if( afterGroup && !isSeparator( node ) )
+                    newLine( indent );
+                print( node, indent );
+                afterGroup = ( node.kind == SparqlSyntaxNode::Group );
+            }
+        }
+
+    private:
+        void print( const SparqlSyntaxNode& node, int indent ) {
+            switch( node.kind ) {
+            case SparqlSyntaxNode::Query:
+            case SparqlSyntaxNode::Statement:
+                printSequence( node.children, indent );
+                break;
+
+            case SparqlSyntaxNode::PrefixDeclaration:
+                newLine( indent );
+                Q_FOREACH( const SparqlSyntaxNode& child, node.children ) {
+                    append( child );
+                }
+                newLine( indent );
+                break;
+
+            case SparqlSyntaxNode::Group:
+                append( node );
+                Q_FOREACH( const SparqlSyntaxNode& statement, node.children ) {
+                    newLine( indent + 1 );
+                    print( statement, indent + 1 );
+                }
+                if( node.closed ) {
+                    newLine( indent );
+                    m_out += QLatin1Char( '}' );
+                    m_atLineStart = false;
+                }
+                break;
+
+            case SparqlSyntaxNode::Brackets:
+                append( node );
+                ++m_bracketDepth;
+                printSequence( node.children, indent );
+                --m_bracketDepth;
+                if( node.closed ) {
+                    m_out += ( node.text == QLatin1String( "(" ) ? QLatin1Char( ')' ) : QLatin1Char( ']' ) );
+                    m_atLineStart = false;
+                }
+                break;
+
+            case SparqlSyntaxNode::Term:
+                append( node );
+                if( node.tokenType == SparqlTokenizer::Comment ) {
+                    if( m_multiLine )
+                        newLine( indent );
+                    else
+                        m_out += QLatin1Char( '\n' );
+                    m_atLineStart = true;
+                }
+                // continue the same subject on the next line
+                else if( m_bracketDepth == 0 &&
+                         node.tokenType == SparqlTokenizer::Punctuation &&
+                         node.text == QLatin1String( ";" ) ) {
+                    newLine( indent + 1 );
+                }
+                break;
+            }
+        }
+
+        void append( const SparqlSyntaxNode& node ) {
+            if( node.spaceBefore && !m_atLineStart )
+                m_out += QLatin1Char( ' ' );
+            m_out += node.text;
+            m_atLineStart = false;
+        }
+
+        void newLine( int indent ) {
+            if( !m_multiLine ) {
+                if( !m_atLineStart )
+                    m_out += QLatin1Char( ' ' );
+            }
+            else {
+                // replace the indentation of an empty line
+                while( m_out.endsWith( QLatin1Char( ' ' ) ) )
+                    m_out.chop( 1 );
+                if( !m_out.isEmpty() && !m_out.endsWith( QLatin1Char( '\n' ) ) )
+                    m_out += QLatin1Char( '\n' );
+                m_out += QString( indent * m_indentWidth, QLatin1Char( ' ' ) );
+            }
+            m_atLineStart = true;
+        }
+
+        QString m_out;
+        int m_indentWidth;
+        bool m_multiLine;
+        bool m_atLineStart;
+        int m_bracketDepth;
+    };
+
+
+    bool isValidLocalName( const QString& name )
+    {
+        if( name.isEmpty() || name.endsWith( QLatin1Char( '.' ) ) ||
+            !( name[0].isLetterOrNumber() || name[0] == QLatin1Char( '_' ) ) )
+            return false;
+        for( int i = 1; i < name.length(); ++i ) {
+            const QChar c = name[i];
+            if( !c.isLetterOrNumber() && c != QLatin1Char( '_' ) && c != QLatin1Char( '-' ) && c != QLatin1Char( '.' ) )
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * Use the last path segment of the namespace, i.e. "nao" for
+     * http://www.semanticdesktop.org/ontologies/2007/08/15/nao#
+     */
+    QString derivePrefix( const QString& ns )
+    {
+        QString name = ns.left( ns.length() - 1 );
+        name = name.mid( name.lastIndexOf( QLatin1Char( '/' ) ) + 1 );
+        if( name == QLatin1String( "rdf-schema" ) )
+            name = QLatin1String( "rdfs" );
+        else if( name == QLatin1String( "22-rdf-syntax-ns" ) )
+            name = QLatin1String( "rdf" );
+        else if( name == QLatin1String( "XMLSchema" ) )
+            name = QLatin1String( "xsd" );
+
+        if( !isValidLocalName( name ) || !name[0].isLetter() )
+            return QString();
+        return name + QLatin1Char( ':' );
+    }
+
+    class PrefixCompactor
+    {
+    public:
+        void addDeclaration( const SparqlSyntaxNode& decl ) {
+            if( decl.children.count() == 3 ) {
+                const QString prefix = decl.children[1].text;
+                const QString iri = decl.children[2].text;
+                m_namespaces.insert( iri.mid( 1, iri.length() - 2 ), prefix );
+                m_usedPrefixes.insert( prefix );
+            }
+        }
+
+        /// Prefixes written in the query without a declaration must not be taken over either
+        void addUsedPrefixes( const SparqlSyntaxNode& node ) {
+            if( node.kind == SparqlSyntaxNode::Term ) {
+                if( node.tokenType == SparqlTokenizer::PrefixedName ) {
+                    const int colon = node.text.indexOf( QLatin1Char( ':' ) );
+                    if( colon >= 0 )
+                        m_usedPrefixes.insert( node.text.left( colon + 1 ) );
+                }
+                return;
+            }
+
+            for( int i = 0; i < node.children.count(); ++i )
+                addUsedPrefixes( node.children[i] );
+        }
+
+        void compact( SparqlSyntaxNode& node ) {
+            if( node.kind == SparqlSyntaxNode::PrefixDeclaration )
+                return;
+
+            if( node.kind == SparqlSyntaxNode::Term ) {
+                if( node.tokenType == SparqlTokenizer::Iri )
+                    compactIri( node );
+                return;
+            }
+
+            for( int i = 0; i < node.children.count(); ++i )
+                compact( node.children[i] );
+        }
+
+        /// The namespaces for which a declaration needs to be added
+        QList<QPair<QString, QString> > newDeclarations() const {
+            return m_newDeclarations;
+        }
+
+    private:
+        void compactIri( SparqlSyntaxNode& node ) {
+            const QString iri = node.text.mid( 1, node.text.length() - 2 );
+            int pos = iri.lastIndexOf( QLatin1Char( '#' ) );
+            if( pos < 0 )
+                pos = iri.lastIndexOf( QLatin1Char( '/' ) );
+            if( pos < 0 )
+                return;
+
+            const QString ns = iri.left( pos + 1 );
+            const QString localName = iri.mid( pos + 1 );
+            if( !isValidLocalName( localName ) || !ns.contains( QLatin1Char( ':' ) ) )
+                return;
+
+            QString prefix = m_namespaces.value( ns );
+            if( prefix.isEmpty() ) {
+                if( m_unusableNamespaces.contains( ns ) )
+                    return;
+
+                prefix = Nepomuk2::PrefixRegistry::self()->prefix( ns );
+                if( prefix.isEmpty() )
+                    prefix = derivePrefix( ns );
+                else
+                    prefix += QLatin1Char( ':' );
+                if( prefix.isEmpty() || m_usedPrefixes.contains( prefix ) ) {
+                    m_unusableNamespaces.insert( ns );
+                    return;
+                }
+
+                m_namespaces.insert( ns, prefix );
+                m_usedPrefixes.insert( prefix );
+                m_newDeclarations << qMakePair( prefix, ns );
+            }
+
+            node.text = prefix + localName;
+            node.tokenType = SparqlTokenizer::PrefixedName;
+        }
+
+        QHash<QString, QString> m_namespaces;
+        QSet<QString> m_usedPrefixes;
+        QSet<QString> m_unusableNamespaces;
+        QList<QPair<QString, QString> > m_newDeclarations;
+    };
+
+    SparqlSyntaxNode term( SparqlTokenizer::TokenType type, const QString& text )
+    {
+        SparqlSyntaxNode node( SparqlSyntaxNode::Term );
+        node.tokenType = type;
+        node.text = text;
+        node.spaceBefore = true;
+        return node;
+    }
+}
+
+
+QString Nepomuk2::SparqlFormatter::prettyPrint( const SparqlSyntaxNode& query, int indentWidth )
+{
+    Printer printer( indentWidth, true );
+    printer.printSequence( query.children, 0 );
+    return printer.result();
+}
+
+
+QString Nepomuk2::SparqlFormatter::toSingleLine( const SparqlSyntaxNode& query )
+{
+    Printer printer( 0, false );
+    printer.printSequence( query.children, 0 );
+    return printer.result();
+}
+
+
+void Nepomuk2::SparqlFormatter::compactPrefixes( SparqlSyntaxNode& query )
+{
+    PrefixCompactor compactor;
+
+    int prologEnd = 0;
+    for( int i = 0; i < query.children.count(); ++i ) {
+        if( query.children[i].kind == SparqlSyntaxNode::PrefixDeclaration ) {
+            compactor.addDeclaration( query.children[i] );
+            prologEnd = i + 1;
+        }
+    }
+
+    compactor.addUsedPrefixes( query );
+    compactor.compact( query );
+
+    // declare the new prefixes after the existing ones to keep the meaning of the query
+    QList<QPair<QString, QString> > declarations = compactor.newDeclarations();
+    for( int i = 0; i < declarations.count(); ++i ) {
+        SparqlSyntaxNode decl( SparqlSyntaxNode::PrefixDeclaration );
+        decl.spaceBefore = true;
+        decl.children << term( SparqlTokenizer::Keyword, QLatin1String( "PREFIX" ) )
+                      << term( SparqlTokenizer::PrefixedName, declarations[i].first )
+                      << term( SparqlTokenizer::Iri, QLatin1Char( '<' ) + declarations[i].second + QLatin1Char( '>' ) );
+        query.children.insert( prologEnd + i, decl );
+    }
+}
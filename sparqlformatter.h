@@ -0,0 +1,61 @@
+/*
+   Copyright (c) 2010-11 Vishesh Handa <handa.vish@gmail.com>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPARQLFORMATTER_H
+#define SPARQLFORMATTER_H
+
+#include <QtCore/QString>
+
+namespace Nepomuk2 {
+
+    class SparqlSyntaxNode;
+
+    /**
+     * Operations on the syntax tree of a query created by SparqlParser.
+     *
+     * All of them only visit each node once. Terms are never changed except
+     * by compactPrefixes(), thus, the meaning of the query is preserved.
+     */
+    class SparqlFormatter
+    {
+    public:
+        /**
+         * Print the query with each prefix declaration and statement on
+         * its own line and groups indented by \p indentWidth spaces.
+         */
+        static QString prettyPrint( const SparqlSyntaxNode& query, int indentWidth = 4 );
+
+        /**
+         * Print the query on a single line. Only comments are followed by
+         * a line break.
+         */
+        static QString toSingleLine( const SparqlSyntaxNode& query );
+
+        /**
+         * Replace full IRIs with prefixed names. The prefixes declared in the
+         * query are used where possible. Otherwise a prefix is derived from the
+         * namespace, for example "nao" for the NAO namespace, and a PREFIX
+         * declaration for it is added to the query.
+         */
+        static void compactPrefixes( SparqlSyntaxNode& query );
+    };
+}
+
+#endif
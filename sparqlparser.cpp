@@ -0,0 +1,230 @@
+/*
+   Copyright (c) 2010-11 Vishesh Handa <handa.vish@gmail.com>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sparqlparser.h"
+
+
+namespace {
+    /// The content of deeper groups and brackets is kept as plain terms, which bounds
+    /// the recursion of the parser and everything walking the tree
+    const int s_maxNestingDepth = 100;
+
+    bool isPunctuation( const Nepomuk2::SparqlTokenizer::Token& token, const QString& tokenText, char c )
+    {
+        return( token.type == Nepomuk2::SparqlTokenizer::Punctuation &&
+                tokenText.length() == 1 &&
+                tokenText[0] == QLatin1Char( c ) );
+    }
+}
+
+
+Nepomuk2::SparqlParser::SparqlParser( const QString& query )
+    : m_tokenizer( query ),
+      m_hasLookahead( false ),
+      m_lastEnd( 0 ),
+      m_depth( 0 )
+{
+}
+
+
+Nepomuk2::SparqlSyntaxNode Nepomuk2::SparqlParser::parse( const QString& query )
+{
+    SparqlParser parser( query );
+
+    SparqlSyntaxNode root( SparqlSyntaxNode::Query );
+    SparqlTokenizer::Token token;
+    while( ( token = parser.nextToken() ).type != SparqlTokenizer::End ) {
+        root.children << parser.parseItem( token );
+    }
+    return root;
+}
+
+
+Nepomuk2::SparqlTokenizer::Token Nepomuk2::SparqlParser::nextToken()
+{
+    SparqlTokenizer::Token token = peekToken();
+    m_hasLookahead = false;
+    return token;
+}
+
+
+Nepomuk2::SparqlTokenizer::Token Nepomuk2::SparqlParser::peekToken()
+{
+    if( !m_hasLookahead ) {
+        m_lookahead = m_tokenizer.next();
+        m_hasLookahead = true;
+    }
+    return m_lookahead;
+}
+
+
+Nepomuk2::SparqlSyntaxNode Nepomuk2::SparqlParser::term( const SparqlTokenizer::Token& token )
+{
+    SparqlSyntaxNode node( SparqlSyntaxNode::Term );
+    node.tokenType = token.type;
+    node.text = m_tokenizer.text( token );
+    node.position = token.start;
+    node.spaceBefore = ( token.start > m_lastEnd );
+    m_lastEnd = token.start + token.length;
+    return node;
+}
+
+
+Nepomuk2::SparqlSyntaxNode Nepomuk2::SparqlParser::parseItem( const SparqlTokenizer::Token& token )
+{
+    const QString text = m_tokenizer.text( token );
+    if( token.type == SparqlTokenizer::Punctuation &&
+        ( text == QLatin1String( "{" ) || text == QLatin1String( "(" ) || text == QLatin1String( "[" ) ) ) {
+        if( m_depth >= s_maxNestingDepth )
+            return parseFlat( token );
+        else if( text == QLatin1String( "{" ) )
+            return parseGroup( token );
+        else
+            return parseBrackets( token );
+    }
+    else if( token.type == SparqlTokenizer::Keyword &&
+             ( text.compare( QLatin1String( "prefix" ), Qt::CaseInsensitive ) == 0 ||
+               text.compare( QLatin1String( "base" ), Qt::CaseInsensitive ) == 0 ) ) {
+        return parsePrefixDeclaration( token );
+    }
+    return term( token );
+}
+
+
+Nepomuk2::SparqlSyntaxNode Nepomuk2::SparqlParser::parsePrefixDeclaration( const SparqlTokenizer::Token& token )
+{
+    SparqlSyntaxNode decl( SparqlSyntaxNode::PrefixDeclaration );
+    decl.children << term( token );
+    decl.position = token.start;
+    decl.spaceBefore = decl.children.first().spaceBefore;
+
+    // PREFIX takes a prefix name and an IRI, BASE only the IRI
+    if( m_tokenizer.text( token ).compare( QLatin1String( "prefix" ), Qt::CaseInsensitive ) == 0 &&
+        peekToken().type == SparqlTokenizer::PrefixedName ) {
+        decl.children << term( nextToken() );
+    }
+    if( peekToken().type == SparqlTokenizer::Iri ) {
+        decl.children << term( nextToken() );
+    }
+    return decl;
+}
+
+
+Nepomuk2::SparqlSyntaxNode Nepomuk2::SparqlParser::parseGroup( const SparqlTokenizer::Token& open )
+{
+    SparqlSyntaxNode group = term( open );
+    group.kind = SparqlSyntaxNode::Group;
+    group.closed = false;
+    ++m_depth;
+
+    SparqlSyntaxNode statement( SparqlSyntaxNode::Statement );
+    SparqlTokenizer::Token token;
+    while( ( token = nextToken() ).type != SparqlTokenizer::End ) {
+        if( isPunctuation( token, m_tokenizer.text( token ), '}' ) ) {
+            m_lastEnd = token.start + token.length;
+            group.closed = true;
+            break;
+        }
+
+        statement.children << parseItem( token );
+        if( isPunctuation( token, m_tokenizer.text( token ), '.' ) ) {
+            statement.position = statement.children.first().position;
+            statement.spaceBefore = statement.children.first().spaceBefore;
+            group.children << statement;
+            statement.children.clear();
+        }
+    }
+
+    if( !statement.children.isEmpty() ) {
+        statement.position = statement.children.first().position;
+        statement.spaceBefore = statement.children.first().spaceBefore;
+        group.children << statement;
+    }
+
+    --m_depth;
+    return group;
+}
+
+
+Nepomuk2::SparqlSyntaxNode Nepomuk2::SparqlParser::parseBrackets( const SparqlTokenizer::Token& open )
+{
+    SparqlSyntaxNode brackets = term( open );
+    brackets.kind = SparqlSyntaxNode::Brackets;
+    brackets.closed = false;
+    ++m_depth;
+
+    const char close = ( brackets.text == QLatin1String( "(" ) ? ')' : ']' );
+    SparqlTokenizer::Token token;
+    while( ( token = nextToken() ).type != SparqlTokenizer::End ) {
+        if( isPunctuation( token, m_tokenizer.text( token ), close ) ) {
+            m_lastEnd = token.start + token.length;
+            brackets.closed = true;
+            break;
+        }
+        brackets.children << parseItem( token );
+    }
+
+    --m_depth;
+    return brackets;
+}
+
+
+Nepomuk2::SparqlSyntaxNode Nepomuk2::SparqlParser::parseFlat( const SparqlTokenizer::Token& open )
+{
+    SparqlSyntaxNode node = term( open );
+    node.kind = ( node.text == QLatin1String( "{" ) ? SparqlSyntaxNode::Group : SparqlSyntaxNode::Brackets );
+    node.closed = false;
+    node.flat = true;
+
+    // the brackets inside are only counted, otherwise their closing brackets would end the enclosing ones
+    QList<SparqlSyntaxNode> terms;
+    int balance = 0;
+    SparqlTokenizer::Token token;
+    while( ( token = nextToken() ).type != SparqlTokenizer::End ) {
+        const QString text = m_tokenizer.text( token );
+        if( token.type == SparqlTokenizer::Punctuation ) {
+            if( text == QLatin1String( "{" ) || text == QLatin1String( "(" ) || text == QLatin1String( "[" ) ) {
+                ++balance;
+            }
+            else if( text == QLatin1String( "}" ) || text == QLatin1String( ")" ) || text == QLatin1String( "]" ) ) {
+                if( balance == 0 ) {
+                    m_lastEnd = token.start + token.length;
+                    node.closed = true;
+                    break;
+                }
+                --balance;
+            }
+        }
+        terms << term( token );
+    }
+
+    // a group consists of statements
+    if( node.kind == SparqlSyntaxNode::Group && !terms.isEmpty() ) {
+        SparqlSyntaxNode statement( SparqlSyntaxNode::Statement );
+        statement.children = terms;
+        statement.position = terms.first().position;
+        statement.spaceBefore = terms.first().spaceBefore;
+        node.children << statement;
+    }
+    else {
+        node.children = terms;
+    }
+    return node;
+}
@@ -0,0 +1,126 @@
+/*
+   Copyright (c) 2010-11 Vishesh Handa <handa.vish@gmail.com>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPARQLPARSER_H
+#define SPARQLPARSER_H
+
+#include "sparqltokenizer.h"
+
+#include <QtCore/QList>
+#include <QtCore/QString>
+
+namespace Nepomuk2 {
+
+    /**
+     * A node in the syntax tree created by SparqlParser.
+     *
+     * The tree only reflects the block structure of a query: prefix declarations,
+     * groups in braces, brackets and the statements in a group, separated by '.'.
+     * The tokens themselves are kept as Term nodes. Thus, printing all terms in order
+     * gives back the original query.
+     */
+    class SparqlSyntaxNode
+    {
+    public:
+        enum Kind {
+            Query,
+            /// PREFIX or BASE with its terms as children
+            PrefixDeclaration,
+            /// { ... } with its statements as children
+            Group,
+            /// ( ... ) or [ ... ] with its terms as children
+            Brackets,
+            Statement,
+            Term
+        };
+
+        SparqlSyntaxNode( Kind k = Term )
+            : kind( k ),
+              tokenType( SparqlTokenizer::Unknown ),
+              position( 0 ),
+              spaceBefore( false ),
+              closed( true ),
+              flat( false ) {
+        }
+
+        Kind kind;
+
+        /// The type of the token of a Term
+        SparqlTokenizer::TokenType tokenType;
+
+        /// The token of a Term or the opening bracket of a Group or Brackets
+        QString text;
+
+        /// The position of the node in the parsed text
+        int position;
+
+        /// true if the node was separated from the preceding one by whitespace
+        bool spaceBefore;
+
+        /// false for groups and brackets which are never closed
+        bool closed;
+
+        /// true for groups and brackets nested too deeply, the brackets inside are kept as terms
+        bool flat;
+
+        QList<SparqlSyntaxNode> children;
+    };
+
+
+    /**
+     * A streaming parser which builds a SparqlSyntaxNode tree from the tokens of
+     * a SparqlTokenizer in one pass.
+     *
+     * The parser is tolerant, any text results in a tree. Unmatched closing
+     * brackets are kept as terms and unclosed groups are closed at the end.
+     * Groups and brackets nested too deeply are not parsed any further, their
+     * content is kept as terms up to the matching closing bracket.
+     */
+    class SparqlParser
+    {
+    public:
+        static SparqlSyntaxNode parse( const QString& query );
+
+    private:
+        SparqlParser( const QString& query );
+
+        SparqlTokenizer::Token nextToken();
+        SparqlTokenizer::Token peekToken();
+
+        SparqlSyntaxNode term( const SparqlTokenizer::Token& token );
+        SparqlSyntaxNode parseItem( const SparqlTokenizer::Token& token );
+        SparqlSyntaxNode parsePrefixDeclaration( const SparqlTokenizer::Token& token );
+        SparqlSyntaxNode parseGroup( const SparqlTokenizer::Token& open );
+        SparqlSyntaxNode parseBrackets( const SparqlTokenizer::Token& open );
+        SparqlSyntaxNode parseFlat( const SparqlTokenizer::Token& open );
+
+        SparqlTokenizer m_tokenizer;
+        SparqlTokenizer::Token m_lookahead;
+        bool m_hasLookahead;
+
+        /// The end of the last token, used to detect whitespace
+        int m_lastEnd;
+
+        /// The number of groups and brackets around the current token
+        int m_depth;
+    };
+}
+
+#endif
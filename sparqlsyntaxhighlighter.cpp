@@ -18,81 +18,238 @@
 
 
 #include "sparqlsyntaxhighlighter.h"
+#include "sparqltokenizer.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+#include <QtCore/QtAlgorithms>
+#include <QtGui/QTextDocument>
+
 #include <KDebug>
 
-Nepomuk2::SparqlSyntaxHighlighter::SparqlSyntaxHighlighter(QTextDocument* parent): QSyntaxHighlighter(parent)
+#include <limits.h>
+
+namespace {
+    /// Documents with fewer blocks are always highlighted at once
+    const int s_deferredHighlightingMinBlocks = 500;
+
+    /// The maximum time in msecs spent in one idle slice
+    const int s_idleSliceDuration = 20;
+
+    /// What the highlighter learned about a block
+    class BlockData : public QTextBlockUserData
+    {
+    public:
+        BlockData() : pending( false ) {}
+
+        /// true if the block has not been highlighted yet
+        bool pending;
+
+        /// the names of the variables in the block, without "?"
+        QStringList variables;
+    };
+
+    BlockData* blockData( const QTextBlock& block )
+    {
+        return dynamic_cast<BlockData*>( block.userData() );
+    }
+
+    bool isPending( const QTextBlock& block )
+    {
+        const BlockData* data = blockData( block );
+        return data && data->pending;
+    }
+}
+
+Nepomuk2::SparqlSyntaxHighlighter::SparqlSyntaxHighlighter(QTextDocument* parent)
+    : QSyntaxHighlighter(parent),
+      m_firstVisibleBlock( 0 ),
+      m_lastVisibleBlock( -1 ),
+      m_idleBlock( -1 ),
+      m_firstPendingBlock( INT_MAX )
 {
+    m_idleTimer.setSingleShot( true );
+    m_idleTimer.setInterval( 0 );
+    connect( &m_idleTimer, SIGNAL(timeout()), this, SLOT(slotHighlightPendingBlocks()) );
+
+    // inserted or removed lines move the pending blocks
+    connect( parent, SIGNAL(contentsChange(int,int,int)), this, SLOT(slotContentsChange(int)) );
+
     init();
 }
 
 void Nepomuk2::SparqlSyntaxHighlighter::init()
 {
+    m_formats.resize( SparqlTokenizer::Unknown + 1 );
+
     // Keywords
+    //FIXME: Separate special inbuilt keywords
     QTextCharFormat keywordFormat;
     keywordFormat.setForeground( Qt::darkMagenta );
     keywordFormat.setFontWeight( QFont::Bold );
-    QStringList keywords;
-
-    //FIXME: Separate special inbuilt keywords
-    keywords << QLatin1String( "\\bprefix\\b" ) << QLatin1String( "\\bselect\\b" ) << QLatin1String( "\\bdistinct\\b" ) << QLatin1String( "\\breduced\\b" )
-             << QLatin1String( "\\bconstruct\\b" ) << QLatin1String( "\\bdescribe\\b" ) << QLatin1String( "\\bask\\b" ) << QLatin1String( "\\bfrom\\b" )
-             << QLatin1String( "\\bnamed\\b" ) << QLatin1String( "\\bwhere\\b" ) << QLatin1String( "\\border\\b" ) << QLatin1String( "\\bby\\b" ) << QLatin1String( "\\basc\\b" )
-             << QLatin1String( "\\bdesc\\b" ) << QLatin1String( "\\blimit\\b" ) << QLatin1String( "\\boffset\\b" ) << QLatin1String( "\\boptional\\b" )
-             << QLatin1String( "\\bgraph\\b" ) << QLatin1String( "\\bunion\\b" ) << QLatin1String( "\\bfilter\\b" ) << QLatin1String( "\\bstr\\b" )
-             << QLatin1String( "\\blang\\b" ) << QLatin1String( "\\blangmatches\\b" ) << QLatin1String( "\\bdatatype\\b" ) << QLatin1String( "\\bbound\\b" )
-             << QLatin1String( "\\bsameTerm\\b" ) << QLatin1String( "\\bisIRI\\b" ) << QLatin1String( "\\bisURI\\b" ) << QLatin1String( "\\bisLiteral\\b" )
-             << QLatin1String( "\\bisBlank\\b" ) << QLatin1String( "\\bregex\\b" ) << QLatin1String( "\\btrue\\b" ) << QLatin1String( "\\bfalse\\b" ) << QLatin1String( "\\ba\\b" );
-
-    foreach( const QString & s, keywords ) {
-        QRegExp regex( s, Qt::CaseInsensitive );
-        m_rules.append( Rule( regex, keywordFormat ) );
-    }
+    m_formats[SparqlTokenizer::Keyword] = keywordFormat;
 
     // Variables
     QTextCharFormat varFormat;
     varFormat.setForeground( Qt::blue );
-    QRegExp varRegex( QLatin1String( "\\?\\w+" ) );
-    m_rules.append( Rule( varRegex, varFormat ) );
+    m_formats[SparqlTokenizer::Variable] = varFormat;
 
     // URI
     QTextCharFormat uriFormat;
     uriFormat.setForeground( Qt::darkGreen );
-    QRegExp uriRegex( QLatin1String( "<[^ >]*>" ) );
-    m_rules.append( Rule( uriRegex, uriFormat ) );
+    m_formats[SparqlTokenizer::Iri] = uriFormat;
 
     // Abbreviated uris --> uri:word
     //TODO: Highlight uri and word with different colours
     QTextCharFormat abrUriFormat;
     abrUriFormat.setForeground( Qt::darkGray );
-    QRegExp abrUriRegex( QLatin1String( "\\b\\w+:\\w*\\b" ) );
-    m_rules.append( Rule( abrUriRegex, abrUriFormat ) );
+    m_formats[SparqlTokenizer::PrefixedName] = abrUriFormat;
+    m_formats[SparqlTokenizer::BlankNode] = abrUriFormat;
 
     // Literals
     QTextCharFormat literalFormat;
     literalFormat.setForeground( Qt::red );
-    QRegExp literalRegex( QLatin1String( "(\"[^\"]*\")|(\'[^\']*\')" ) );
-    m_rules.append( Rule( literalRegex, literalFormat ) );
+    m_formats[SparqlTokenizer::String] = literalFormat;
+    m_formats[SparqlTokenizer::LanguageTag] = literalFormat;
 
     // Comments
     QTextCharFormat commentFormat;
     commentFormat.setForeground( Qt::darkYellow );
-    QRegExp commentRegex( QLatin1String( "^#.*$" ) );
-    m_rules.append( Rule( commentRegex, commentFormat ) );
+    m_formats[SparqlTokenizer::Comment] = commentFormat;
 }
 
 void Nepomuk2::SparqlSyntaxHighlighter::highlightBlock(const QString& text)
 {
-    //kDebug();
-    //int i=0;
-    foreach (const Rule &rule, m_rules) {
-        QRegExp expression(rule.pattern);
-        int index = expression.indexIn(text);
-        int length = 0;
-        while (index >= 0 && ( length = expression.matchedLength() ) > 0 ) {
-            //kDebug() << "Setting " << i;
-            setFormat(index, length, rule.format);
-            index = expression.indexIn(text, index + length);
+    const int previousState = previousBlockState();
+
+    const int blockNumber = currentBlock().blockNumber();
+    if( isDeferred( blockNumber ) ) {
+        // Assume the block does not change the state, which is true unless it contains
+        // the beginning or end of a long string. Thus, highlighting it later typically
+        // does not require to highlight the following blocks again.
+        setCurrentBlockState( previousState < 0 ? SparqlTokenizer::NormalState : previousState );
+        BlockData* data = blockData( currentBlock() );
+        if( !data ) {
+            data = new BlockData();
+            setCurrentBlockUserData( data );
         }
-        //i++;
+        data->pending = true;
+
+        m_firstPendingBlock = qMin( m_firstPendingBlock, blockNumber );
+        if( !m_idleTimer.isActive() )
+            m_idleTimer.start();
+        return;
+    }
+
+    BlockData* data = blockData( currentBlock() );
+    if( !data ) {
+        data = new BlockData();
+        setCurrentBlockUserData( data );
+    }
+    data->pending = false;
+    data->variables.clear();
+
+    SparqlTokenizer tokenizer( text, previousState < 0 ? SparqlTokenizer::NormalState
+                                                       : SparqlTokenizer::State( previousState ) );
+
+    SparqlTokenizer::Token token;
+    while( ( token = tokenizer.next() ).type != SparqlTokenizer::End ) {
+        const QTextCharFormat& format = m_formats.at( token.type );
+        if( format.propertyCount() > 0 )
+            setFormat( token.start, token.length, format );
+        if( token.type == SparqlTokenizer::Variable )
+            data->variables << text.mid( token.start + 1, token.length - 1 );
+    }
+
+    setCurrentBlockState( tokenizer.state() );
+}
+
+
+bool Nepomuk2::SparqlSyntaxHighlighter::isDeferred( int blockNumber ) const
+{
+    return( document()->blockCount() >= s_deferredHighlightingMinBlocks &&
+            blockNumber != m_idleBlock &&
+            ( blockNumber < m_firstVisibleBlock || blockNumber > m_lastVisibleBlock ) );
+}
+
+
+QStringList Nepomuk2::SparqlSyntaxHighlighter::variables() const
+{
+    QSet<QString> variables;
+    for( QTextBlock block = document()->begin(); block.isValid(); block = block.next() ) {
+        if( const BlockData* data = blockData( block ) ) {
+            Q_FOREACH( const QString& variable, data->variables ) {
+                variables.insert( variable );
+            }
+        }
+    }
+
+    QStringList result = variables.toList();
+    qSort( result );
+    return result;
+}
+
+
+void Nepomuk2::SparqlSyntaxHighlighter::setVisibleBlocks( int first, int last )
+{
+    m_firstVisibleBlock = first;
+    m_lastVisibleBlock = last;
+
+    highlightPendingBlocks( first, last );
+}
+
+
+void Nepomuk2::SparqlSyntaxHighlighter::highlightPendingBlocks( int first, int last )
+{
+    // in order, so each block starts with the exact state of the one before
+    for( QTextBlock block = document()->findBlockByNumber( first );
+         block.isValid() && block.blockNumber() <= last;
+         block = block.next() ) {
+        if( isPending( block ) ) {
+            m_idleBlock = block.blockNumber();
+            rehighlightBlock( block );
+            m_idleBlock = -1;
+        }
+    }
+}
+
+
+void Nepomuk2::SparqlSyntaxHighlighter::slotContentsChange( int position )
+{
+    // Blocks before the change keep their numbers, the pending ones after it are
+    // found again from the changed block on.
+    if( m_firstPendingBlock != INT_MAX ) {
+        const QTextBlock block = document()->findBlock( position );
+        if( block.isValid() )
+            m_firstPendingBlock = qMin( m_firstPendingBlock, block.blockNumber() );
+        else
+            m_firstPendingBlock = 0;
+    }
+}
+
+
+void Nepomuk2::SparqlSyntaxHighlighter::slotHighlightPendingBlocks()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QTextBlock block = document()->findBlockByNumber( m_firstPendingBlock );
+    while( block.isValid() && !timer.hasExpired( s_idleSliceDuration ) ) {
+        if( isPending( block ) ) {
+            m_idleBlock = block.blockNumber();
+            rehighlightBlock( block );
+            m_idleBlock = -1;
+        }
+        block = block.next();
+    }
+
+    // Highlighting the blocks only marks following blocks as pending, never preceding ones
+    if( block.isValid() ) {
+        m_firstPendingBlock = block.blockNumber();
+        m_idleTimer.start();
+    }
+    else {
+        m_firstPendingBlock = INT_MAX;
     }
 }
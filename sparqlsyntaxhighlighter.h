@@ -20,12 +20,22 @@
 #ifndef SPARQLSYNTAXHIGHLIGHTER_H
 #define SPARQLSYNTAXHIGHLIGHTER_H
 
+#include <QtCore/QVector>
 #include <QtCore/QStringList>
-#include <QtCore/QRegExp>
+#include <QtCore/QTimer>
 #include <QtGui/QSyntaxHighlighter>
 
 namespace Nepomuk2 {
     
+    /**
+     * Highlights each block in a single pass of the SparqlTokenizer. Long strings
+     * spanning several blocks are tracked through the block state.
+     *
+     * In large documents only the visible blocks are highlighted right away. All
+     * other blocks are marked as pending and highlighted in short slices whenever
+     * the event loop is idle. An edit simply marks its blocks as pending again,
+     * thus, no work is spent on outdated text.
+     */
     class SparqlSyntaxHighlighter : public QSyntaxHighlighter
     {
         Q_OBJECT
@@ -34,17 +44,47 @@ namespace Nepomuk2 {
 
         virtual void highlightBlock(const QString& text);
 
+        /**
+         * \return The names of the variables in the document without "?" or "$",
+         * collected while highlighting. Blocks which have not been highlighted
+         * yet are not taken into account.
+         */
+        QStringList variables() const;
+
+    public Q_SLOTS:
+        /**
+         * Set the range of blocks shown in the editor. Pending blocks in
+         * this range are highlighted immediately.
+         */
+        void setVisibleBlocks( int first, int last );
+
+        /**
+         * Highlight the pending blocks from \p first to \p last right away.
+         * Used before the block states are read to tokenize a part of the document,
+         * the state of a pending block is only guessed.
+         */
+        void highlightPendingBlocks( int first, int last );
+
+    private Q_SLOTS:
+        void slotContentsChange( int position );
+        void slotHighlightPendingBlocks();
+
     private:
         void init();
-        
-        struct Rule {
-            QRegExp pattern;
-            QTextCharFormat format;
-
-            Rule( const QRegExp & r, const QTextCharFormat & f )
-                : pattern(r), format(f) {}
-        };
-        QList<Rule> m_rules;
+        bool isDeferred( int blockNumber ) const;
+
+        /// The format of each SparqlTokenizer::TokenType
+        QVector<QTextCharFormat> m_formats;
+
+        int m_firstVisibleBlock;
+        int m_lastVisibleBlock;
+
+        /// The block currently highlighted from the idle timer
+        int m_idleBlock;
+
+        /// All pending blocks come after this one, moved back to the changed block on each edit
+        int m_firstPendingBlock;
+        QTimer m_idleTimer;
     };
 }
 #endif // SPARQLSYNTAXHIGHLIGHTER_H
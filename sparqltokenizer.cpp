@@ -0,0 +1,290 @@
+/*
+   Copyright (c) 2010-11 Vishesh Handa <handa.vish@gmail.com>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sparqltokenizer.h"
+
+#include <QtCore/QSet>
+
+#include <KGlobal>
+
+
+namespace {
+    class KeywordSet : public QSet<QString>
+    {
+    public:
+        KeywordSet() {
+            const char* keywords[] = {
+                "base", "prefix", "select", "distinct", "reduced", "construct", "describe", "ask",
+                "from", "named", "where", "order", "by", "asc", "desc", "limit", "offset", "optional",
+                "graph", "union", "filter", "a", "true", "false", "as", "group", "having", "values",
+                "bind", "minus", "exists", "not", "in", "service", "silent", "undef",
+                "insert", "delete", "data", "with", "using", "default", "all", "load", "clear",
+                "drop", "create", "add", "move", "copy", "into", "to",
+                "str", "lang", "langmatches", "datatype", "bound", "sameterm", "isiri", "isuri",
+                "isliteral", "isblank", "isnumeric", "regex", "iri", "uri", "bnode", "if", "coalesce",
+                "strlen", "substr", "ucase", "lcase", "strstarts", "strends", "contains",
+                "concat", "replace", "count", "sum", "min", "max", "avg", "sample", "group_concat",
+                "separator",
+                0
+            };
+            for( int i = 0; keywords[i]; ++i )
+                insert( QLatin1String( keywords[i] ) );
+        }
+    };
+
+    inline bool isNameChar( const QChar& c )
+    {
+        return c.isLetterOrNumber() || c == QLatin1Char( '_' ) || c == QLatin1Char( '-' );
+    }
+
+    inline bool isIriChar( const QChar& c )
+    {
+        // See IRIREF in the SPARQL grammar
+        return !c.isSpace() && c != QLatin1Char( '<' ) && c != QLatin1Char( '"' ) &&
+            c != QLatin1Char( '{' ) && c != QLatin1Char( '}' ) && c != QLatin1Char( '|' ) &&
+            c != QLatin1Char( '^' ) && c != QLatin1Char( '`' ) && c != QLatin1Char( '\\' );
+    }
+}
+
+K_GLOBAL_STATIC( KeywordSet, s_keywords )
+
+
+Nepomuk2::SparqlTokenizer::SparqlTokenizer( const QString& text, State state )
+    : m_text( text ),
+      m_pos( 0 ),
+      m_state( state )
+{
+}
+
+
+bool Nepomuk2::SparqlTokenizer::isKeyword( const QString& word )
+{
+    return s_keywords->contains( word.toLower() );
+}
+
+
+Nepomuk2::SparqlTokenizer::Token Nepomuk2::SparqlTokenizer::next()
+{
+    const int len = m_text.length();
+
+    // continue a string from the previous text
+    if( m_state == LongDoubleQuoteString && m_pos < len )
+        return readLongString( m_pos, QLatin1Char( '"' ) );
+    else if( m_state == LongSingleQuoteString && m_pos < len )
+        return readLongString( m_pos, QLatin1Char( '\'' ) );
+
+    while( m_pos < len && m_text[m_pos].isSpace() )
+        ++m_pos;
+    if( m_pos >= len )
+        return Token( End, len, 0 );
+
+    const int start = m_pos;
+    const QChar c = m_text[m_pos];
+    const QChar n = m_pos + 1 < len ? m_text[m_pos + 1] : QChar();
+
+    switch( c.unicode() ) {
+    case '#':
+        while( m_pos < len && m_text[m_pos] != QLatin1Char( '\n' ) )
+            ++m_pos;
+        return Token( Comment, start, m_pos - start );
+
+    case '?':
+    case '$':
+        if( n.isLetterOrNumber() || n == QLatin1Char( '_' ) ) {
+            ++m_pos;
+            while( m_pos < len && ( m_text[m_pos].isLetterOrNumber() || m_text[m_pos] == QLatin1Char( '_' ) ) )
+                ++m_pos;
+            return Token( Variable, start, m_pos - start );
+        }
+        // the zero-or-one property path modifier
+        ++m_pos;
+        return Token( Operator, start, 1 );
+
+    case '<': {
+        int pos = m_pos + 1;
+        while( pos < len && isIriChar( m_text[pos] ) && m_text[pos] != QLatin1Char( '>' ) )
+            ++pos;
+        if( pos < len && m_text[pos] == QLatin1Char( '>' ) ) {
+            m_pos = pos + 1;
+            return Token( Iri, start, m_pos - start );
+        }
+        // not an IRI but the less-than operator
+        m_pos += ( n == QLatin1Char( '=' ) ? 2 : 1 );
+        return Token( Operator, start, m_pos - start );
+    }
+
+    case '"':
+    case '\'':
+        if( n == c && m_pos + 2 < len && m_text[m_pos + 2] == c ) {
+            m_pos += 3;
+            m_state = ( c == QLatin1Char( '"' ) ? LongDoubleQuoteString : LongSingleQuoteString );
+            return readLongString( start, c );
+        }
+        ++m_pos;
+        while( m_pos < len && m_text[m_pos] != c && m_text[m_pos] != QLatin1Char( '\n' ) ) {
+            if( m_text[m_pos] == QLatin1Char( '\\' ) )
+                ++m_pos;
+            ++m_pos;
+        }
+        if( m_pos < len && m_text[m_pos] == c )
+            ++m_pos;
+        m_pos = qMin( m_pos, len );
+        return Token( String, start, m_pos - start );
+
+    case '@':
+        ++m_pos;
+        while( m_pos < len && ( m_text[m_pos].isLetterOrNumber() || m_text[m_pos] == QLatin1Char( '-' ) ) )
+            ++m_pos;
+        return Token( m_pos - start > 1 ? LanguageTag : Unknown, start, m_pos - start );
+
+    case '_':
+        if( n == QLatin1Char( ':' ) ) {
+            m_pos = skipNameChars( m_pos + 2 );
+            return Token( BlankNode, start, m_pos - start );
+        }
+        return readName( start );
+
+    case ':':
+        return readName( start );
+
+    case '{': case '}': case '(': case ')': case '[': case ']': case ';': case ',':
+        ++m_pos;
+        return Token( Punctuation, start, 1 );
+
+    case '.':
+        if( !n.isDigit() ) {
+            ++m_pos;
+            return Token( Punctuation, start, 1 );
+        }
+        break;
+
+    case '^':
+        m_pos += ( n == QLatin1Char( '^' ) ? 2 : 1 );
+        return Token( Punctuation, start, m_pos - start );
+
+    case '>': case '!': case '=':
+        m_pos += ( n == QLatin1Char( '=' ) ? 2 : 1 );
+        return Token( Operator, start, m_pos - start );
+
+    case '|':
+        // a single '|' separates alternative property paths
+        m_pos += ( n == c ? 2 : 1 );
+        return Token( Operator, start, m_pos - start );
+
+    case '&':
+        m_pos += ( n == c ? 2 : 1 );
+        return Token( n == c ? Operator : Unknown, start, m_pos - start );
+
+    case '+': case '-': case '*': case '/':
+        ++m_pos;
+        return Token( Operator, start, 1 );
+
+    default:
+        break;
+    }
+
+    if( c.isDigit() || c == QLatin1Char( '.' ) ) {
+        while( m_pos < len && m_text[m_pos].isDigit() )
+            ++m_pos;
+        if( m_pos + 1 < len && m_text[m_pos] == QLatin1Char( '.' ) && m_text[m_pos + 1].isDigit() ) {
+            ++m_pos;
+            while( m_pos < len && m_text[m_pos].isDigit() )
+                ++m_pos;
+        }
+        if( m_pos < len && ( m_text[m_pos] == QLatin1Char( 'e' ) || m_text[m_pos] == QLatin1Char( 'E' ) ) ) {
+            int pos = m_pos + 1;
+            if( pos < len && ( m_text[pos] == QLatin1Char( '+' ) || m_text[pos] == QLatin1Char( '-' ) ) )
+                ++pos;
+            if( pos < len && m_text[pos].isDigit() ) {
+                m_pos = pos;
+                while( m_pos < len && m_text[m_pos].isDigit() )
+                    ++m_pos;
+            }
+        }
+        return Token( Number, start, m_pos - start );
+    }
+
+    if( c.isLetter() )
+        return readName( start );
+
+    ++m_pos;
+    return Token( Unknown, start, 1 );
+}
+
+
+Nepomuk2::SparqlTokenizer::Token Nepomuk2::SparqlTokenizer::readLongString( int start, QChar quote )
+{
+    const int len = m_text.length();
+    while( m_pos < len ) {
+        if( m_text[m_pos] == QLatin1Char( '\\' ) ) {
+            m_pos += 2;
+        }
+        else if( m_text[m_pos] == quote &&
+                 m_pos + 2 < len &&
+                 m_text[m_pos + 1] == quote &&
+                 m_text[m_pos + 2] == quote ) {
+            m_pos += 3;
+            m_state = NormalState;
+            return Token( String, start, m_pos - start );
+        }
+        else {
+            ++m_pos;
+        }
+    }
+
+    // the string continues after the end of the text
+    m_pos = len;
+    return Token( String, start, m_pos - start );
+}
+
+
+Nepomuk2::SparqlTokenizer::Token Nepomuk2::SparqlTokenizer::readName( int start )
+{
+    int pos = skipNameChars( start );
+    if( pos < m_text.length() && m_text[pos] == QLatin1Char( ':' ) ) {
+        m_pos = skipNameChars( pos + 1 );
+        return Token( PrefixedName, start, m_pos - start );
+    }
+
+    m_pos = pos;
+    if( isKeyword( m_text.mid( start, pos - start ) ) )
+        return Token( Keyword, start, pos - start );
+    else
+        return Token( Name, start, pos - start );
+}
+
+
+int Nepomuk2::SparqlTokenizer::skipNameChars( int pos ) const
+{
+    const int len = m_text.length();
+    while( pos < len ) {
+        if( isNameChar( m_text[pos] ) ) {
+            ++pos;
+        }
+        // dots are allowed inside but not at the end of names
+        else if( m_text[pos] == QLatin1Char( '.' ) && pos + 1 < len && isNameChar( m_text[pos + 1] ) ) {
+            ++pos;
+        }
+        else {
+            break;
+        }
+    }
+    return pos;
+}
@@ -0,0 +1,109 @@
+/*
+   Copyright (c) 2010-11 Vishesh Handa <handa.vish@gmail.com>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPARQLTOKENIZER_H
+#define SPARQLTOKENIZER_H
+
+#include <QtCore/QString>
+
+namespace Nepomuk2 {
+
+    /**
+     * A hand-written single-pass SPARQL lexer.
+     *
+     * Each character is looked at once, thus, tokenizing is linear in the length
+     * of the text. The tokenizer never fails, characters which cannot start any
+     * token are returned as Unknown tokens.
+     *
+     * Long strings (""" and ''') may span several lines. The tokenizer can be
+     * started and stopped in the middle of such a string through state(), which
+     * allows to tokenize a document line by line as done by the syntax highlighter.
+     */
+    class SparqlTokenizer
+    {
+    public:
+        enum TokenType {
+            End = 0,
+            Keyword,
+            Variable,
+            Iri,
+            PrefixedName,
+            BlankNode,
+            String,
+            LanguageTag,
+            Number,
+            Comment,
+            /// bare words which are not keywords, like function names
+            Name,
+            Punctuation,
+            Operator,
+            Unknown
+        };
+
+        enum State {
+            NormalState = 0,
+            /// inside a """ string
+            LongDoubleQuoteString,
+            /// inside a ''' string
+            LongSingleQuoteString
+        };
+
+        struct Token {
+            Token( TokenType t = End, int s = 0, int l = 0 )
+                : type( t ), start( s ), length( l ) {}
+
+            TokenType type;
+            int start;
+            int length;
+        };
+
+        /**
+         * \param text The text to tokenize.
+         * \param state The state at the beginning of \p text, typically the
+         * state() after the preceding text.
+         */
+        SparqlTokenizer( const QString& text, State state = NormalState );
+
+        /**
+         * \return The next token or a token of type End.
+         */
+        Token next();
+
+        /**
+         * The state after the last token returned by next().
+         */
+        State state() const { return m_state; }
+
+        QString text( const Token& token ) const { return m_text.mid( token.start, token.length ); }
+
+        static bool isKeyword( const QString& word );
+
+    private:
+        Token readLongString( int start, QChar quote );
+        Token readName( int start );
+        int skipNameChars( int pos ) const;
+
+        QString m_text;
+        int m_pos;
+        State m_state;
+    };
+}
+
+#endif
@@ -0,0 +1,268 @@
+/*
+   Copyright (c) 2010-11 Vishesh Handa <handa.vish@gmail.com>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sparqlvalidator.h"
+#include "sparqlparser.h"
+
+#include <KLocale>
+
+
+namespace {
+    using Nepomuk2::SparqlSyntaxNode;
+    using Nepomuk2::SparqlSyntaxError;
+    using Nepomuk2::SparqlTokenizer;
+
+    bool isTerminatedString( const QString& text )
+    {
+        const QChar quote = text[0];
+        const int quoteLength = ( text.startsWith( QString( 3, quote ) ) ? 3 : 1 );
+        if( text.length() < 2 * quoteLength || !text.endsWith( QString( quoteLength, quote ) ) )
+            return false;
+
+        // the closing quote must not be escaped
+        int backslashes = 0;
+        for( int i = text.length() - quoteLength - 1; i >= quoteLength && text[i] == QLatin1Char( '\\' ); --i )
+            ++backslashes;
+        return backslashes % 2 == 0;
+    }
+
+    bool isPunctuation( const SparqlSyntaxNode& node, const char* text )
+    {
+        return( node.kind == SparqlSyntaxNode::Term &&
+                node.tokenType == SparqlTokenizer::Punctuation &&
+                node.text == QLatin1String( text ) );
+    }
+
+    /**
+     * Statements which only consist of terms are triple patterns. Anything
+     * else, like keywords, operators or nested groups, is not checked.
+     */
+    bool isTriplePattern( const SparqlSyntaxNode& statement )
+    {
+        Q_FOREACH( const SparqlSyntaxNode& node, statement.children ) {
+            if( node.kind == SparqlSyntaxNode::Brackets )
+                continue;
+            if( node.kind != SparqlSyntaxNode::Term )
+                return false;
+
+            switch( node.tokenType ) {
+            case SparqlTokenizer::Variable:
+            case SparqlTokenizer::Iri:
+            case SparqlTokenizer::PrefixedName:
+            case SparqlTokenizer::BlankNode:
+            case SparqlTokenizer::String:
+            case SparqlTokenizer::LanguageTag:
+            case SparqlTokenizer::Number:
+            case SparqlTokenizer::Comment:
+                break;
+            case SparqlTokenizer::Keyword:
+                if( node.text != QLatin1String( "a" ) &&
+                    node.text.compare( QLatin1String( "true" ), Qt::CaseInsensitive ) != 0 &&
+                    node.text.compare( QLatin1String( "false" ), Qt::CaseInsensitive ) != 0 )
+                    return false;
+                break;
+            case SparqlTokenizer::Punctuation:
+                if( !isPunctuation( node, "." ) && !isPunctuation( node, ";" ) &&
+                    !isPunctuation( node, "," ) && !isPunctuation( node, "^^" ) )
+                    return false;
+                break;
+            default:
+                return false;
+            }
+        }
+        return true;
+    }
+
+    class Validator
+    {
+    public:
+        void validateSequence( const QList<SparqlSyntaxNode>& nodes ) {
+            bool inValues = false;
+            Q_FOREACH( const SparqlSyntaxNode& node, nodes ) {
+                validate( node, inValues );
+                if( node.kind == SparqlSyntaxNode::Term &&
+                    node.tokenType == SparqlTokenizer::Keyword ) {
+                    inValues = ( node.text.compare( QLatin1String( "values" ), Qt::CaseInsensitive ) == 0 );
+                }
+                else if( node.kind == SparqlSyntaxNode::Group ) {
+                    inValues = false;
+                }
+            }
+        }
+
+        QList<SparqlSyntaxError> errors;
+
+    private:
+        void validate( const SparqlSyntaxNode& node, bool inValues ) {
+            switch( node.kind ) {
+            case SparqlSyntaxNode::Query:
+            case SparqlSyntaxNode::Statement:
+            case SparqlSyntaxNode::PrefixDeclaration:
+                validateSequence( node.children );
+                break;
+
+            case SparqlSyntaxNode::Group:
+                if( !node.closed )
+                    errors << SparqlSyntaxError( SparqlSyntaxError::UnclosedBracket, node.position, 1, node.text );
+                if( node.flat ) {
+                    validateFlat( node.children );
+                    break;
+                }
+                Q_FOREACH( const SparqlSyntaxNode& statement, node.children ) {
+                    // the rows of a VALUES block are no triple patterns
+                    if( !inValues && isTriplePattern( statement ) )
+                        validateTriplePattern( statement );
+                    validate( statement, false );
+                }
+                break;
+
+            case SparqlSyntaxNode::Brackets:
+                if( !node.closed )
+                    errors << SparqlSyntaxError( SparqlSyntaxError::UnclosedBracket, node.position, 1, node.text );
+                if( node.flat )
+                    validateFlat( node.children );
+                else
+                    validateSequence( node.children );
+                break;
+
+            case SparqlSyntaxNode::Term:
+                validateTerm( node );
+                break;
+            }
+        }
+
+        /**
+         * The content of groups and brackets nested too deeply for the parser.
+         * Their brackets are balanced but kept as terms, only the terms
+         * themselves are checked.
+         */
+        void validateFlat( const QList<SparqlSyntaxNode>& nodes ) {
+            Q_FOREACH( const SparqlSyntaxNode& node, nodes ) {
+                if( node.kind != SparqlSyntaxNode::Term )
+                    validateFlat( node.children );
+                else if( node.tokenType != SparqlTokenizer::Punctuation )
+                    validateTerm( node );
+            }
+        }
+
+        void validateTerm( const SparqlSyntaxNode& node ) {
+            switch( node.tokenType ) {
+            case SparqlTokenizer::Unknown:
+                errors << SparqlSyntaxError( SparqlSyntaxError::UnknownCharacter, node.position, node.text.length(), node.text );
+                break;
+            case SparqlTokenizer::String:
+                if( !isTerminatedString( node.text ) )
+                    errors << SparqlSyntaxError( SparqlSyntaxError::UnterminatedString, node.position, node.text.length() );
+                break;
+            case SparqlTokenizer::Punctuation:
+                // matched brackets never end up as terms
+                if( node.text == QLatin1String( "}" ) ||
+                    node.text == QLatin1String( ")" ) ||
+                    node.text == QLatin1String( "]" ) )
+                    errors << SparqlSyntaxError( SparqlSyntaxError::UnmatchedBracket, node.position, 1, node.text );
+                break;
+            default:
+                break;
+            }
+        }
+
+        /**
+         * Check the number of terms between the separators: a full triple
+         * before the first ';' or ',', a predicate and object after ';' and
+         * an object after ','.
+         */
+        void validateTriplePattern( const SparqlSyntaxNode& statement ) {
+            int expected = 3;
+            int count = 0;
+            bool blankNodeSubject = false;
+            bool skipNext = false;
+            int start = -1;
+            int end = -1;
+
+            for( int i = 0; i <= statement.children.count(); ++i ) {
+                const bool atEnd = ( i == statement.children.count() );
+                const SparqlSyntaxNode& node = atEnd ? statement.children.last() : statement.children[i];
+
+                if( atEnd || isPunctuation( node, "." ) || isPunctuation( node, ";" ) || isPunctuation( node, "," ) ) {
+                    bool valid = ( count == expected || count == 0 );
+                    // a blank node with properties may be used on its own
+                    if( expected == 3 && count == 1 && blankNodeSubject )
+                        valid = true;
+                    if( !valid )
+                        errors << SparqlSyntaxError( SparqlSyntaxError::IncompleteTriplePattern, start, end - start );
+
+                    if( atEnd || isPunctuation( node, "." ) )
+                        break;
+                    if( isPunctuation( node, ";" ) )
+                        expected = 2;
+                    else
+                        expected = 1;
+                    count = 0;
+                    start = -1;
+                }
+                else if( node.tokenType == SparqlTokenizer::Comment ||
+                         node.tokenType == SparqlTokenizer::LanguageTag ) {
+                    // not a term of its own
+                }
+                else if( isPunctuation( node, "^^" ) ) {
+                    // the datatype belongs to the literal
+                    skipNext = true;
+                }
+                else if( skipNext ) {
+                    skipNext = false;
+                }
+                else {
+                    if( count == 0 && expected == 3 )
+                        blankNodeSubject = ( node.kind == SparqlSyntaxNode::Brackets && !node.children.isEmpty() );
+                    if( start < 0 )
+                        start = node.position;
+                    end = node.position + ( node.kind == SparqlSyntaxNode::Term ? node.text.length() : 1 );
+                    ++count;
+                }
+            }
+        }
+    };
+}
+
+
+QString Nepomuk2::SparqlSyntaxError::message() const
+{
+    switch( type ) {
+    case UnknownCharacter:
+        return i18n( "Unexpected character '%1'", token );
+    case UnterminatedString:
+        return i18n( "Unterminated string" );
+    case UnmatchedBracket:
+        return i18n( "'%1' without matching opening bracket", token );
+    case UnclosedBracket:
+        return i18n( "'%1' is never closed", token );
+    case IncompleteTriplePattern:
+        return i18n( "A triple pattern needs a subject, a predicate and an object" );
+    }
+    return QString();
+}
+
+
+QList<Nepomuk2::SparqlSyntaxError> Nepomuk2::SparqlValidator::validate( const QString& query )
+{
+    Validator validator;
+    validator.validateSequence( SparqlParser::parse( query ).children );
+    return validator.errors;
+}
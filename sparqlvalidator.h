@@ -0,0 +1,76 @@
+/*
+   Copyright (c) 2010-11 Vishesh Handa <handa.vish@gmail.com>
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of
+   the License or (at your option) version 3 or any later version
+   accepted by the membership of KDE e.V. (or its successor approved
+   by the membership of KDE e.V.), which shall act as a proxy
+   defined in Section 14 of version 3 of the license.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPARQLVALIDATOR_H
+#define SPARQLVALIDATOR_H
+
+#include <QtCore/QList>
+#include <QtCore/QString>
+
+namespace Nepomuk2 {
+
+    class SparqlSyntaxError
+    {
+    public:
+        enum Type {
+            UnknownCharacter,
+            UnterminatedString,
+            UnmatchedBracket,
+            UnclosedBracket,
+            /// A triple pattern with too few or too many terms
+            IncompleteTriplePattern
+        };
+
+        SparqlSyntaxError( Type t = UnknownCharacter, int pos = 0, int len = 0, const QString& tok = QString() )
+            : type( t ), position( pos ), length( len ), token( tok ) {}
+
+        /**
+         * The translated description of the error. Only call this from the
+         * GUI thread.
+         */
+        QString message() const;
+
+        Type type;
+        int position;
+        int length;
+
+        /// The offending token, if any
+        QString token;
+    };
+
+
+    /**
+     * Finds syntax errors in a query without sending it to the store.
+     *
+     * Only mistakes which are errors in any SPARQL dialect are reported,
+     * Virtuoso extensions are not flagged. The check is based on the
+     * SparqlParser and is linear in the length of the query.
+     */
+    class SparqlValidator
+    {
+    public:
+        /**
+         * This is reentrant, thus, it can be run in a worker thread.
+         */
+        static QList<SparqlSyntaxError> validate( const QString& query );
+    };
+}
+
+#endif
@@ -23,6 +23,7 @@
 
 #include <QtCore/QUrl>
 #include <QtCore/QList>
+#include <QtCore/QSet>
 
 #include <Nepomuk2/Resource>
 #include <Nepomuk2/Query/Result>
@@ -150,9 +151,12 @@ void Nepomuk2::Utils::SimpleResourceModel::setResults( const QList<Nepomuk2::Que
 
 void Nepomuk2::Utils::SimpleResourceModel::addResults( const QList<Nepomuk2::Query::Result>& results )
 {
+    // one insertion for the whole batch, proxies can then sort and merge it in one go
+    QList<Resource> resources;
     Q_FOREACH( const Query::Result& result, results ) {
-        addResource( result.resource() );
+        resources << result.resource();
     }
+    addResources( resources );
 }
 
 void Nepomuk2::Utils::SimpleResourceModel::addResult( const Nepomuk2::Query::Result result )
@@ -161,6 +165,31 @@ void Nepomuk2::Utils::SimpleResourceModel::addResult( const Nepomuk2::Query::Res
 }
 
 
+void Nepomuk2::Utils::SimpleResourceModel::removeResources( const QList<QUrl>& uris )
+{
+    const QSet<QUrl> uriSet = uris.toSet();
+    QList<int> rows;
+    for( int i = 0; i < d->resources.count(); ++i ) {
+        if( uriSet.contains( d->resources[i].uri() ) ) {
+            rows.append( i );
+        }
+    }
+
+    // remove from the bottom up so the remaining row numbers stay valid
+    int i = rows.count() - 1;
+    while( i >= 0 ) {
+        const int last = rows[i];
+        int first = last;
+        while( i > 0 && rows[i-1] == first-1 ) {
+            --i;
+            --first;
+        }
+        removeRows( first, last - first + 1 );
+        --i;
+    }
+}
+
+
 void Nepomuk2::Utils::SimpleResourceModel::clear()
 {
     d->resources.clear();
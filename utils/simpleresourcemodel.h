@@ -129,6 +129,12 @@ namespace Nepomuk2 {
              */
             void addResult( const Nepomuk2::Query::Result result );
 
+            /**
+             * Remove the resources identified by \p uris from the model. Consecutive
+             * rows are removed in one go via removeRows().
+             */
+            void removeResources( const QList<QUrl>& uris );
+
             /**
              * Clear the model by removing all resources added via setResources() and friends.
              */